@@ -11,9 +11,6 @@
 #define PIT_PORT_CONTROL          0x43                /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
 
@@ -81,3 +78,98 @@ pit_configure_channel (int channel, int mode, int frequency)
   outb (PIT_PORT_COUNTER (channel), count >> 8);
   intr_set_level (old_level);
 }
+
+/* Starts CHANNEL counting down COUNT PIT cycles in mode 0
+   ("interrupt on terminal count").  The channel's output goes
+   high once, when the count reaches zero, and stays high until
+   the channel is reprogrammed, so on channel 0 this raises a
+   single timer interrupt after COUNT / PIT_HZ seconds.  COUNT
+   must be between 1 and PIT_COUNT_MAX. */
+void
+pit_start_oneshot (int channel, unsigned count)
+{
+  enum intr_level old_level;
+
+  ASSERT (channel == 0 || channel == 2);
+  ASSERT (count >= 1 && count <= PIT_COUNT_MAX);
+
+  /* A count of 0 stands for PIT_COUNT_MAX. */
+  count %= PIT_COUNT_MAX;
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30);
+  outb (PIT_PORT_COUNTER (channel), count);
+  outb (PIT_PORT_COUNTER (channel), count >> 8);
+  intr_set_level (old_level);
+}
+
+/* Returns the number of cycles CHANNEL still has to count down
+   in its current period.  The counter is latched first, so the
+   two bytes read belong to the same count. */
+unsigned
+pit_read_count (int channel)
+{
+  enum intr_level old_level;
+  unsigned count;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, channel << 6);
+  count = inb (PIT_PORT_COUNTER (channel));
+  count |= inb (PIT_PORT_COUNTER (channel)) << 8;
+  intr_set_level (old_level);
+
+  return count;
+}
+
+/* Latches CHANNEL's output level and count together, using the
+   8254 read-back command, stores the output level in *OUTPUT,
+   and returns the count.  In mode 0 the output is true once the
+   one-shot count has expired, after which the count keeps going
+   down from PIT_COUNT_MAX. */
+unsigned
+pit_read_back (int channel, bool *output)
+{
+  enum intr_level old_level;
+  uint8_t status;
+  unsigned count;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, 0xc0 | (2 << channel));
+  status = inb (PIT_PORT_COUNTER (channel));
+  count = inb (PIT_PORT_COUNTER (channel));
+  count |= inb (PIT_PORT_COUNTER (channel)) << 8;
+  intr_set_level (old_level);
+
+  *output = (status & 0x80) != 0;
+  return count;
+}
+
+/* Puts CHANNEL back into mode 2 with a period of FREQUENCY Hz,
+   but makes the first period only FIRST cycles long, so that
+   the periodic interrupts fall where they would have if the
+   channel had never left mode 2.  FIRST must be between 2 and
+   PIT_COUNT_MAX, and FREQUENCY as for pit_configure_channel(). */
+void
+pit_resume_periodic (int channel, unsigned first, int frequency)
+{
+  uint16_t count = (PIT_HZ + frequency / 2) / frequency;
+  enum intr_level old_level;
+
+  ASSERT (channel == 0 || channel == 2);
+  ASSERT (first >= 2 && first <= PIT_COUNT_MAX);
+  ASSERT (frequency >= 19 && frequency <= PIT_HZ);
+
+  /* A count written in mode 2 without a new control word takes
+     effect when the current period ends. */
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30 | (2 << 1));
+  outb (PIT_PORT_COUNTER (channel), first);
+  outb (PIT_PORT_COUNTER (channel), first >> 8);
+  outb (PIT_PORT_COUNTER (channel), count);
+  outb (PIT_PORT_COUNTER (channel), count >> 8);
+  intr_set_level (old_level);
+}
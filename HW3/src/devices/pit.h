@@ -1,8 +1,19 @@
 #ifndef DEVICES_PIT_H
 #define DEVICES_PIT_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
+/* PIT cycles per second. */
+#define PIT_HZ 1193180
+
+/* Largest count a channel can be loaded with. */
+#define PIT_COUNT_MAX 65536
+
 void pit_configure_channel (int channel, int mode, int frequency);
+void pit_start_oneshot (int channel, unsigned count);
+unsigned pit_read_count (int channel);
+unsigned pit_read_back (int channel, bool *output);
+void pit_resume_periodic (int channel, unsigned first, int frequency);
 
 #endif /* devices/pit.h */
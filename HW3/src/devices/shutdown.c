@@ -6,6 +6,7 @@
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
@@ -138,4 +139,5 @@ print_stats (void)
 #ifdef USERPROG
   exception_print_stats ();
 #endif
+  trace_dump ();
 }
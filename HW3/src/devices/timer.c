@@ -7,6 +7,7 @@
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -21,6 +22,22 @@
 static int64_t ticks;
 struct list slept_process_list;
 
+/* PIT cycles per timer tick. */
+#define CYCLES_PER_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Most ticks a single one-shot count can cover. */
+#define TICKLESS_MAX_TICKS (PIT_COUNT_MAX / CYCLES_PER_TICK)
+
+/* If true, stop the periodic tick while the CPU is idle.
+   Controlled by kernel command-line option "-o tickless". */
+bool timer_tickless;
+
+/* While the CPU idles in tickless mode, the PIT is running a
+   one-shot count that ends on the oneshot_ticks'th tick boundary
+   from the last one added to `ticks'. */
+static bool in_oneshot;
+static int64_t oneshot_ticks;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
@@ -30,6 +47,8 @@ static bool too_many_loops(unsigned loops);
 static void busy_wait(int64_t loops);
 static void real_time_sleep(int64_t num, int32_t denom);
 static void real_time_delay(int64_t num, int32_t denom);
+static int64_t next_deadline(void);
+static void end_oneshot(void);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
@@ -93,6 +112,8 @@ void timer_sleep(int64_t ticks)
   old_intr_level = intr_disable();
 
   thread_current()->wakeup = timer_ticks() + ticks;
+  if (trace_enabled)
+    trace_sleep(thread_current(), thread_current()->wakeup);
   list_push_back(&slept_process_list, &(thread_current()->elem));
   thread_block();
 
@@ -100,6 +121,51 @@ void timer_sleep(int64_t ticks)
   return;
 }
 
+/* Called by the idle thread, with interrupts off, just before
+   it halts the CPU.  In tickless mode, replaces the periodic
+   tick by a single interrupt at the next tick at which a
+   sleeping thread must be woken or the scheduler has periodic
+   work to do, so the CPU is not woken up for nothing. */
+void timer_idle_enter(void)
+{
+  int64_t sleep_ticks;
+  unsigned phase;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+  if (!timer_tickless || in_oneshot)
+    return;
+
+  sleep_ticks = next_deadline() - ticks;
+  if (sleep_ticks > TICKLESS_MAX_TICKS)
+    sleep_ticks = TICKLESS_MAX_TICKS;
+  if (sleep_ticks < 2)
+    return;
+
+  /* Stay on the periodic tick's grid: the current period has
+     already run for PHASE cycles. */
+  phase = CYCLES_PER_TICK - pit_read_count(0);
+  if (phase >= CYCLES_PER_TICK)
+    phase = 0;
+
+  oneshot_ticks = sleep_ticks;
+  in_oneshot = true;
+  pit_start_oneshot(0, sleep_ticks * CYCLES_PER_TICK - phase);
+}
+
+/* Called by the scheduler, with interrupts off, before it picks
+   the next thread to run.  If the idle thread left a one-shot
+   count running, catches `ticks' up with the time that passed
+   and goes back to the periodic tick, so that whatever runs
+   next is preempted as usual.  This also covers the idle thread
+   being switched out straight from the interrupt that woke it
+   up. */
+void timer_idle_exit(void)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+  if (in_oneshot)
+    end_oneshot();
+}
+
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
    turned on. */
 void timer_msleep(int64_t ms)
@@ -167,11 +233,89 @@ void timer_print_stats(void)
 static void
 timer_interrupt(struct intr_frame *args UNUSED)
 {
+  /* Account for the ticks skipped by a one-shot count.  If the
+     count has not expired, this is a periodic tick that was
+     already pending when the count was started. */
+  if (in_oneshot)
+    end_oneshot();
+
   /* Increment the ticks. */
   ticks++;
   thread_tick();
 }
 
+/* Returns the tick at which the idle CPU must next get a timer
+   interrupt: the earliest sleeper's wakeup time, or, for the
+   schedulers that recompute load once per second, the next
+   whole second if that comes first. */
+static int64_t
+next_deadline(void)
+{
+  int64_t deadline = INT64_MAX;
+  struct list_elem *iter;
+
+  for (iter = list_begin(&slept_process_list);
+       iter != list_end(&slept_process_list);
+       iter = list_next(iter))
+  {
+    struct thread *entry = list_entry(iter, struct thread, elem);
+    if (entry->wakeup < deadline)
+      deadline = entry->wakeup;
+  }
+
+  if (thread_mlfqs || thread_prior_aging)
+  {
+    int64_t second = (ticks / TIMER_FREQ + 1) * TIMER_FREQ;
+    if (second < deadline)
+      deadline = second;
+  }
+
+  return deadline;
+}
+
+/* Leaves one-shot mode: adds the tick boundaries the count has
+   crossed so far to `ticks' and the idle thread's statistics,
+   and restarts the periodic tick in phase with them.  Once the
+   count has expired, the interrupt it raised is still pending
+   and adds the last of those ticks itself. */
+static void
+end_oneshot(void)
+{
+  bool expired;
+  unsigned count = pit_read_back(0, &expired);
+  int64_t elapsed;
+  unsigned first;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (expired)
+  {
+    /* The count reached zero on the oneshot_ticks'th boundary
+       and has been going down from PIT_COUNT_MAX since. */
+    unsigned since = (PIT_COUNT_MAX - count) % PIT_COUNT_MAX;
+    elapsed = oneshot_ticks - 1 + since / CYCLES_PER_TICK;
+    first = CYCLES_PER_TICK - since % CYCLES_PER_TICK;
+  }
+  else
+  {
+    /* The count ends on a boundary, so the next one is what is
+       left of it modulo a tick. */
+    elapsed = oneshot_ticks - DIV_ROUND_UP(count, CYCLES_PER_TICK);
+    first = count % CYCLES_PER_TICK;
+    if (first == 0)
+      first = CYCLES_PER_TICK;
+  }
+
+  /* A count of 1 is illegal in mode 2; one cycle is 0.8 us. */
+  if (first < 2)
+    first = 2;
+
+  in_oneshot = false;
+  ticks += elapsed;
+  thread_account_idle(elapsed);
+  pit_resume_periodic(0, first, TIMER_FREQ);
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
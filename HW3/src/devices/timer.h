@@ -2,6 +2,7 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
@@ -10,6 +11,11 @@
 void timer_init (void);
 void timer_calibrate (void);
 
+/* Dynamic tick. */
+extern bool timer_tickless;
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
 
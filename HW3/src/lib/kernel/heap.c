@@ -0,0 +1,155 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* Leftist heap.
+
+   See heap.h for basic information. */
+
+static struct heap_elem *merge (struct heap *,
+                                struct heap_elem *, struct heap_elem *);
+
+/* Initializes heap H as an empty heap that orders its elements
+   using LESS, given auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux)
+{
+  ASSERT (h != NULL);
+  ASSERT (less != NULL);
+
+  h->root = NULL;
+  h->elem_cnt = 0;
+  h->next_seq = 0;
+  h->less = less;
+  h->aux = aux;
+}
+
+/* Inserts E into heap H. */
+void
+heap_push (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+
+  e->left = e->right = NULL;
+  e->rank = 1;
+  e->seq = h->next_seq++;
+  h->root = merge (h, h->root, e);
+  h->elem_cnt++;
+}
+
+/* Removes the least element from heap H and returns it.
+   Undefined behavior if H is empty before removal. */
+struct heap_elem *
+heap_pop (struct heap *h)
+{
+  struct heap_elem *top = heap_top (h);
+
+  h->root = merge (h, top->left, top->right);
+  h->elem_cnt--;
+  return top;
+}
+
+/* Returns the least element in heap H without removing it.
+   Undefined behavior if H is empty. */
+struct heap_elem *
+heap_top (struct heap *h)
+{
+  ASSERT (!heap_empty (h));
+  return h->root;
+}
+
+/* Restores the ordering of heap H after the keys of elements
+   already in it have changed, in O(n log n) time.  Elements that
+   compare equal keep their original insertion order. */
+void
+heap_rebuild (struct heap *h)
+{
+  struct heap_elem *chain = NULL;
+
+  ASSERT (h != NULL);
+
+  /* Popping still visits every element exactly once even though
+     the tree is no longer ordered. */
+  while (h->root != NULL)
+    {
+      struct heap_elem *e = h->root;
+      h->root = merge (h, e->left, e->right);
+      e->right = chain;
+      chain = e;
+    }
+
+  while (chain != NULL)
+    {
+      struct heap_elem *e = chain;
+      chain = e->right;
+      e->left = e->right = NULL;
+      e->rank = 1;
+      h->root = merge (h, h->root, e);
+    }
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (struct heap *h)
+{
+  return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+heap_empty (struct heap *h)
+{
+  return h->root == NULL;
+}
+
+/* Returns the rank of subtree E, which is 0 for an empty one. */
+static inline unsigned
+rank (const struct heap_elem *e)
+{
+  return e != NULL ? e->rank : 0;
+}
+
+/* Returns true if A must leave heap H before B: either A is
+   less than B, or they are equal and A was inserted first. */
+static bool
+before (struct heap *h, const struct heap_elem *a,
+        const struct heap_elem *b)
+{
+  if (h->less (a, b, h->aux))
+    return true;
+  else if (h->less (b, a, h->aux))
+    return false;
+  else
+    return (int) (a->seq - b->seq) < 0;
+}
+
+/* Merges the subtrees rooted at A and B within heap H and
+   returns the root of the result.  Only the right spines are
+   walked, so this takes O(log n) steps. */
+static struct heap_elem *
+merge (struct heap *h, struct heap_elem *a, struct heap_elem *b)
+{
+  struct heap_elem *tmp;
+
+  if (a == NULL)
+    return b;
+  if (b == NULL)
+    return a;
+
+  if (before (h, b, a))
+    {
+      tmp = a;
+      a = b;
+      b = tmp;
+    }
+
+  a->right = merge (h, a->right, b);
+  if (rank (a->left) < rank (a->right))
+    {
+      tmp = a->left;
+      a->left = a->right;
+      a->right = tmp;
+    }
+  a->rank = rank (a->right) + 1;
+  return a;
+}
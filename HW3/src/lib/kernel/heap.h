@@ -0,0 +1,74 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Mergeable priority queue.
+
+   This is a leftist heap: a binary tree in which every node
+   orders before its children and in which the path down the
+   right spine is always the shortest one.  Insertion and
+   removal of the minimum are both a merge along right spines, so
+   they take O(log n) time in the worst case, and the minimum is
+   always available at the root in O(1).
+
+   Like the list and hash table, the heap does not use dynamic
+   allocation.  Each structure that can potentially be in a heap
+   must embed a struct heap_elem member, and the heap_entry macro
+   converts from a struct heap_elem back to the structure object
+   that contains it.  Refer to lib/kernel/list.h for a detailed
+   explanation of the technique.
+
+   Elements that compare equal leave the heap in the order in
+   which they were inserted, so a heap can stand in for a
+   list_insert_ordered() queue without losing its FIFO
+   behavior among equals. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem
+  {
+    struct heap_elem *left;     /* Left subtree. */
+    struct heap_elem *right;    /* Right subtree, never the deeper one. */
+    unsigned rank;              /* Length of the right spine, plus 1. */
+    unsigned seq;               /* Insertion order, breaks ties. */
+  };
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+        ((STRUCT *) ((uint8_t *) (HEAP_ELEM)            \
+                     - offsetof (STRUCT, MEMBER)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B.  The least element
+   is the one at the top of the heap. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Heap. */
+struct heap
+  {
+    struct heap_elem *root;     /* Least element, or null if empty. */
+    size_t elem_cnt;            /* Number of elements in heap. */
+    unsigned next_seq;          /* Sequence number for next insertion. */
+    heap_less_func *less;       /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+void heap_push (struct heap *, struct heap_elem *);
+struct heap_elem *heap_pop (struct heap *);
+struct heap_elem *heap_top (struct heap *);
+void heap_rebuild (struct heap *);
+
+size_t heap_size (struct heap *);
+bool heap_empty (struct heap *);
+
+#endif /* lib/kernel/heap.h */
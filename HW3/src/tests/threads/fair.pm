@@ -0,0 +1,64 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::threads::mlfqs;
+
+# Load weight for each nice value from -20 to 20, as in
+# threads/thread.c.
+our (@nice_to_weight) = (
+    88761, 71755, 56483, 46273, 36291,
+    29154, 23254, 18705, 14949, 11916,
+    9548, 7620, 6100, 4904, 3906,
+    3121, 2501, 1991, 1586, 1277,
+    1024, 820, 655, 526, 423,
+    335, 272, 215, 172, 137,
+    110, 87, 70, 56, 45,
+    36, 29, 23, 18, 15,
+    12);
+
+# Returns the number of ticks that threads with the given nice
+# values should receive out of 3000 under the fair-share
+# scheduler: each one's share is proportional to its weight.
+sub fair_expected_ticks {
+    my (@nice) = @_;
+    my (@weight) = map ($nice_to_weight[$_ + 20], @nice);
+    my ($total) = 0;
+    $total += $_ foreach @weight;
+    return map (3000 * $_ / $total, @weight);
+}
+
+sub check_fair_share {
+    my ($nice, $maxdiff) = @_;
+    our ($test);
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+
+    my (@actual);
+    local ($_);
+    foreach (@output) {
+	my ($id, $count) = /Thread (\d+) received (\d+) ticks\./ or next;
+        $actual[$id] = $count;
+    }
+
+    my (@expected) = fair_expected_ticks (@$nice);
+    mlfqs_compare ("thread", "%.0f",
+		   \@actual, \@expected, $maxdiff, [0, $#$nice, 1],
+		   "Some tick counts were missing or differed from those "
+		   . "expected by more than $maxdiff.");
+
+    # Report how far from a perfectly weighted split the run was,
+    # and how many of the 3000 ticks the load threads got at all,
+    # for comparison with the same workload under -mlfqs.
+    my ($error, $received) = (0, 0);
+    for my $i (0...$#$nice) {
+	my ($diff) = abs ($actual[$i] - $expected[$i]);
+	$error = $diff if $diff > $error;
+	$received += $actual[$i];
+    }
+    pass (sprintf ("Fairness error (largest deviation, in ticks): %.0f.",
+		   $error),
+	  "Load threads received $received of 3000 ticks.");
+}
+
+1;
@@ -13,7 +13,15 @@
    They should receive 672, 588, 492, 408, 316, 232, 152, 92, 40,
    and 8 ticks, respectively, over 30 seconds.
 
-   (The above are computed via simulation in mlfqs.pm.) */
+   (The above are computed via simulation in mlfqs.pm.)
+
+   The fair-2, fair-20, fair-nice-2 and fair-nice-10 tests run
+   the same workloads under the fair-share scheduler ("-fair"),
+   for comparison.  There each thread should receive a share of
+   the 3000 ticks proportional to its load weight, as computed in
+   fair.pm: 1,500 each for fair-2, 150 each for fair-20, 2,260
+   and 740 for fair-nice-2, and 671, 537, 429, 345, 277, 219,
+   178, 141, 113 and 90 for fair-nice-10. */
 
 #include <stdio.h>
 #include <inttypes.h>
@@ -50,6 +58,30 @@ test_mlfqs_nice_10 (void)
 {
   test_mlfqs_fair (10, 0, 1);
 }
+
+void
+test_fair_2 (void) 
+{
+  test_mlfqs_fair (2, 0, 0);
+}
+
+void
+test_fair_20 (void) 
+{
+  test_mlfqs_fair (20, 0, 0);
+}
+
+void
+test_fair_nice_2 (void) 
+{
+  test_mlfqs_fair (2, 0, 5);
+}
+
+void
+test_fair_nice_10 (void) 
+{
+  test_mlfqs_fair (10, 0, 1);
+}
 
 #define MAX_THREAD_CNT 20
 
@@ -70,7 +102,7 @@ test_mlfqs_fair (int thread_cnt, int nice_min, int nice_step)
   int nice;
   int i;
 
-  ASSERT (thread_mlfqs);
+  ASSERT (thread_mlfqs || thread_fair);
   ASSERT (thread_cnt <= MAX_THREAD_CNT);
   ASSERT (nice_min >= -10);
   ASSERT (nice_step >= 0);
@@ -0,0 +1,115 @@
+/* Blocks a couple hundred threads, many of them sharing a
+   priority, first on a semaphore and then on a condition
+   variable, and checks that they are woken up in order of
+   decreasing priority, first come first served within a
+   priority. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define WAITER_CNT 200
+
+static thread_func sema_waiter_thread;
+static thread_func cond_waiter_thread;
+static void start_waiters (thread_func *);
+static void check_order (const char *what);
+
+static struct semaphore sema;
+static struct lock lock;
+static struct condition condition;
+
+/* Index of each waiter in the order it woke up. */
+static int woke[WAITER_CNT];
+static int woke_cnt;
+
+static int
+waiter_priority (int i)
+{
+  return PRI_DEFAULT - 1 - (i * 7) % 30;
+}
+
+void
+test_priority_waiters (void)
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  thread_set_priority (PRI_MIN);
+
+  sema_init (&sema, 0);
+  start_waiters (sema_waiter_thread);
+  for (i = 0; i < WAITER_CNT; i++)
+    sema_up (&sema);
+  check_order ("a semaphore");
+
+  lock_init (&lock);
+  cond_init (&condition);
+  start_waiters (cond_waiter_thread);
+  for (i = 0; i < WAITER_CNT; i++)
+    {
+      lock_acquire (&lock);
+      cond_signal (&condition, &lock);
+      lock_release (&lock);
+    }
+  check_order ("a condition variable");
+}
+
+/* Creates WAITER_CNT threads running FUNC.  Each one outranks
+   the main thread, so it runs and blocks right away. */
+static void
+start_waiters (thread_func *func)
+{
+  int i;
+
+  woke_cnt = 0;
+  for (i = 0; i < WAITER_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "waiter %d", i);
+      thread_create (name, waiter_priority (i), func, (void *) i);
+    }
+}
+
+static void
+check_order (const char *what)
+{
+  int i;
+
+  if (woke_cnt != WAITER_CNT)
+    fail ("only %d of %d threads woke up from %s",
+          woke_cnt, WAITER_CNT, what);
+  for (i = 1; i < WAITER_CNT; i++)
+    {
+      int prev = woke[i - 1], cur = woke[i];
+      if (waiter_priority (prev) < waiter_priority (cur)
+          || (waiter_priority (prev) == waiter_priority (cur)
+              && prev > cur))
+        fail ("waiter %d (priority %d) woke up from %s "
+              "before waiter %d (priority %d)",
+              prev, waiter_priority (prev), what,
+              cur, waiter_priority (cur));
+    }
+  msg ("%d threads woke up from %s in priority order.", WAITER_CNT, what);
+}
+
+static void
+sema_waiter_thread (void *aux)
+{
+  sema_down (&sema);
+  woke[woke_cnt++] = (int) aux;
+}
+
+static void
+cond_waiter_thread (void *aux)
+{
+  lock_acquire (&lock);
+  cond_wait (&condition, &lock);
+  woke[woke_cnt++] = (int) aux;
+  lock_release (&lock);
+}
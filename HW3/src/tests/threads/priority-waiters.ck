@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-waiters) begin
+(priority-waiters) 200 threads woke up from a semaphore in priority order.
+(priority-waiters) 200 threads woke up from a condition variable in priority order.
+(priority-waiters) end
+EOF
+pass;
@@ -32,6 +32,7 @@ static const struct test tests[] =
     {"priority-sema", test_priority_sema},
     {"priority-aging", test_priority_aging},
     {"priority-condvar", test_priority_condvar},
+    {"priority-waiters", test_priority_waiters},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -41,6 +42,10 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"fair-2", test_fair_2},
+    {"fair-20", test_fair_20},
+    {"fair-nice-2", test_fair_nice_2},
+    {"fair-nice-10", test_fair_nice_10},
   };
 
 static const char *test_name;
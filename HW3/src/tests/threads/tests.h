@@ -26,6 +26,7 @@ extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_aging;
 extern test_func test_priority_condvar;
+extern test_func test_priority_waiters;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -35,6 +36,10 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_fair_2;
+extern test_func test_fair_20;
+extern test_func test_fair_nice_2;
+extern test_func test_fair_nice_10;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
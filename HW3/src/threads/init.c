@@ -22,6 +22,7 @@
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -97,6 +98,7 @@ int main(void)
   palloc_init(user_page_limit);
   malloc_init();
   paging_init();
+  trace_init();
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -257,6 +259,12 @@ parse_options(char **argv)
       thread_mlfqs = true;
     else if (!strcmp(name, "-aging"))
       thread_prior_aging = true;
+    else if (!strcmp(name, "-fair"))
+      thread_fair = true;
+    else if (!strcmp(name, "-tickless"))
+      timer_tickless = true;
+    else if (!strcmp(name, "-trace"))
+      trace_enabled = true;
 #ifdef USERPROG
     else if (!strcmp(name, "-ul"))
       user_page_limit = atoi(value);
@@ -379,6 +387,9 @@ usage(void)
 #endif
          "  -rs=SEED           Set random number seed to SEED.\n"
          "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+         "  -fair              Use fair-share (virtual runtime) scheduler.\n"
+         "  -tickless          Stop the periodic timer tick while idle.\n"
+         "  -trace             Record scheduler events, dump at shutdown.\n"
 #ifdef USERPROG
          "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -32,6 +32,13 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+static bool sema_waiter_less(const struct heap_elem *,
+                             const struct heap_elem *, void *);
+static bool cond_waiter_less(const struct heap_elem *,
+                             const struct heap_elem *, void *);
+static void push_waiter(struct heap *, unsigned *epoch, struct heap_elem *);
+static struct heap_elem *pop_waiter(struct heap *, unsigned *epoch);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -46,7 +53,8 @@ void sema_init(struct semaphore *sema, unsigned value)
   ASSERT(sema != NULL);
 
   sema->value = value;
-  list_init(&sema->waiters);
+  heap_init(&sema->waiters, sema_waiter_less, NULL);
+  sema->epoch = thread_priority_epoch;
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -66,7 +74,7 @@ void sema_down(struct semaphore *sema)
   old_level = intr_disable();
   while (sema->value == 0)
   {
-    list_push_back(&sema->waiters, &thread_current()->elem);
+    push_waiter(&sema->waiters, &sema->epoch, &thread_current()->heap_elem);
     thread_block();
   }
   sema->value--;
@@ -109,8 +117,9 @@ void sema_up(struct semaphore *sema)
   ASSERT(sema != NULL);
   //
   old_level = intr_disable();
-  if (!list_empty(&sema->waiters))
-    thread_unblock(pop_HPT(&sema->waiters));
+  if (!heap_empty(&sema->waiters))
+    thread_unblock(heap_entry(pop_waiter(&sema->waiters, &sema->epoch),
+                              struct thread, heap_elem));
   sema->value++;
   intr_set_level(old_level);
 
@@ -241,8 +250,9 @@ bool lock_held_by_current_thread(const struct lock *lock)
 /* One semaphore in a list. */
 struct semaphore_elem
 {
-  struct list_elem elem;      /* List element. */
+  struct heap_elem elem;      /* Heap element. */
   struct semaphore semaphore; /* This semaphore. */
+  struct thread *thread;      /* Thread waiting on `semaphore'. */
 };
 
 /* Initializes condition variable COND.  A condition variable
@@ -252,7 +262,8 @@ void cond_init(struct condition *cond)
 {
   ASSERT(cond != NULL);
 
-  list_init(&cond->waiters);
+  heap_init(&cond->waiters, cond_waiter_less, NULL);
+  cond->epoch = thread_priority_epoch;
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -285,7 +296,8 @@ void cond_wait(struct condition *cond, struct lock *lock)
   ASSERT(lock_held_by_current_thread(lock));
 
   sema_init(&waiter.semaphore, 0);
-  list_push_back(&cond->waiters, &waiter.elem);
+  waiter.thread = thread_current();
+  push_waiter(&cond->waiters, &cond->epoch, &waiter.elem);
   lock_release(lock);
   sema_down(&waiter.semaphore);
   lock_acquire(lock);
@@ -305,8 +317,8 @@ void cond_signal(struct condition *cond, struct lock *lock UNUSED)
   ASSERT(!intr_context());
   ASSERT(lock_held_by_current_thread(lock));
 
-  if (!list_empty(&cond->waiters))
-    sema_up(&list_entry(list_pop_front(&cond->waiters),
+  if (!heap_empty(&cond->waiters))
+    sema_up(&heap_entry(pop_waiter(&cond->waiters, &cond->epoch),
                         struct semaphore_elem, elem)
                  ->semaphore);
 }
@@ -322,6 +334,50 @@ void cond_broadcast(struct condition *cond, struct lock *lock)
   ASSERT(cond != NULL);
   ASSERT(lock != NULL);
 
-  while (!list_empty(&cond->waiters))
+  while (!heap_empty(&cond->waiters))
     cond_signal(cond, lock);
 }
+
+/* Orders threads waiting on a semaphore so that the one with
+   the highest priority is at the top of the heap. */
+static bool sema_waiter_less(const struct heap_elem *a,
+                             const struct heap_elem *b, void *aux UNUSED)
+{
+  return heap_entry(a, struct thread, heap_elem)->priority >
+         heap_entry(b, struct thread, heap_elem)->priority;
+}
+
+/* Same as sema_waiter_less(), for the semaphores that threads
+   waiting on a condition variable sleep on. */
+static bool cond_waiter_less(const struct heap_elem *a,
+                             const struct heap_elem *b, void *aux UNUSED)
+{
+  return heap_entry(a, struct semaphore_elem, elem)->thread->priority >
+         heap_entry(b, struct semaphore_elem, elem)->thread->priority;
+}
+
+/* Adds E to wait heap WAITERS, whose ordering is valid as of
+   priority epoch *EPOCH. */
+static void push_waiter(struct heap *waiters, unsigned *epoch,
+                        struct heap_elem *e)
+{
+  if (heap_empty(waiters))
+    *epoch = thread_priority_epoch;
+  heap_push(waiters, e);
+}
+
+/* Removes and returns the highest-priority waiter in WAITERS.
+   The MLFQS may have recomputed the priorities of blocked
+   threads since WAITERS was last ordered, as recorded in *EPOCH;
+   if so, the heap is reordered first, so that the cost of
+   catching up is paid once per recomputation rather than on
+   every wakeup. */
+static struct heap_elem *pop_waiter(struct heap *waiters, unsigned *epoch)
+{
+  if (*epoch != thread_priority_epoch)
+  {
+    heap_rebuild(waiters);
+    *epoch = thread_priority_epoch;
+  }
+  return heap_pop(waiters);
+}
@@ -1,6 +1,7 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
 
@@ -8,7 +9,8 @@
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting threads, highest priority first. */
+    unsigned epoch;             /* Priority epoch `waiters' is ordered by. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -33,7 +35,8 @@ bool lock_held_by_current_thread (const struct lock *);
 /* Condition variable. */
 struct condition 
   {
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting threads, highest priority first. */
+    unsigned epoch;             /* Priority epoch `waiters' is ordered by. */
   };
 
 void cond_init (struct condition *);
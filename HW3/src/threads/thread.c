@@ -10,6 +10,7 @@
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "threads/fixed_point.h"
 #include "devices/timer.h"
@@ -43,6 +44,15 @@ static struct lock tid_lock;
 extern struct list slept_process_list;
 static int32_t load_avg;
 
+/* Threads in THREAD_READY state under the fair-share scheduler,
+   ordered by virtual runtime.  Used instead of ready_list when
+   thread_fair is set. */
+static struct heap fair_queue;
+
+/* Monotonic lower bound of the virtual runtimes of all runnable
+   threads.  Woken threads are placed relative to it. */
+static int64_t min_vruntime;
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame
 {
@@ -60,6 +70,37 @@ static long long user_ticks;   /* # of timer ticks in user programs. */
 #define TIME_SLICE 4          /* # of timer ticks to give each thread. */
 static unsigned thread_ticks; /* # of timer ticks since last yield. */
 
+/* Fair-share scheduling.  Virtual runtime is kept in units of
+   1/VRUNTIME_SCALE of a tick run at nice 0; a thread with a
+   heavier weight accumulates it more slowly. */
+#define VRUNTIME_SCALE 1024
+#define NICE_0_WEIGHT 1024
+
+/* Most virtual runtime a woken or new thread may be credited
+   for the time it spent off the run queue. */
+#define FAIR_SLEEPER_CREDIT (TIME_SLICE * VRUNTIME_SCALE)
+
+/* A ready thread this far behind the running one preempts it
+   before its time slice expires. */
+#define FAIR_WAKEUP_GRAN (FAIR_SLEEPER_CREDIT / 2)
+
+/* Load weight for each nice value from NICE_MIN to NICE_MAX.
+   Each step is worth about 10% of CPU time relative to a
+   neighbouring thread. */
+#define NICE_MIN -20
+#define NICE_MAX 20
+static const int nice_to_weight[NICE_MAX - NICE_MIN + 1] = {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */ 9548, 7620, 6100, 4904, 3906,
+    /*  -5 */ 3121, 2501, 1991, 1586, 1277,
+    /*   0 */ 1024, 820, 655, 526, 423,
+    /*   5 */ 335, 272, 215, 172, 137,
+    /*  10 */ 110, 87, 70, 56, 45,
+    /*  15 */ 36, 29, 23, 18, 15,
+    /*  20 */ 12,
+};
+
 /* If false (default), use priority scheduler without
    aging techniques, so it could invoke starvation!
    If true, use priority scheduler with aging condition.
@@ -71,6 +112,20 @@ bool thread_prior_aging;
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* Bumped by refresh_priority() when a blocked thread's priority
+   changes.  See thread.h. */
+unsigned thread_priority_epoch;
+
+/* True while thread_preempt() is switching away from the
+   running thread, so that the trace can tell preemption from a
+   voluntary yield. */
+static bool preempting;
+
+/* If true, use the fair-share scheduler, which always runs the
+   ready thread with the least weighted virtual runtime.
+   Controlled by kernel command-line option "-o fair". */
+bool thread_fair;
+
 static void kernel_thread(thread_func *, void *aux);
 static void idle(void *aux UNUSED);
 static struct thread *running_thread();
@@ -81,6 +136,9 @@ static void *alloc_frame(struct thread *, size_t size);
 static void schedule();
 void thread_schedule_tail(struct thread *prev);
 static tid_t allocate_tid();
+static void fair_enqueue(struct thread *, bool woken);
+static void fair_tick(struct thread *);
+static void fair_update_min_vruntime(struct thread *);
 
 bool priority_comp(const struct list_elem *a, const struct list_elem *b)
 {
@@ -88,6 +146,13 @@ bool priority_comp(const struct list_elem *a, const struct list_elem *b)
           (list_entry(b, struct thread, elem)->priority));
 }
 
+static bool vruntime_less(const struct heap_elem *a,
+                          const struct heap_elem *b, void *aux UNUSED)
+{
+  return (heap_entry(a, struct thread, heap_elem)->vruntime <
+          heap_entry(b, struct thread, heap_elem)->vruntime);
+}
+
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
    general and it is possible in this case only because loader.S
@@ -108,6 +173,8 @@ void thread_init()
   lock_init(&tid_lock);
   list_init(&ready_list);
   list_init(&all_process_list);
+  heap_init(&fair_queue, vruntime_less, NULL);
+  min_vruntime = 0;
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread();
@@ -156,11 +223,21 @@ void thread_tick()
   if (++thread_ticks >= TIME_SLICE)
     intr_yield_on_return();
 
+  if (thread_fair && t != idle_thread)
+    fair_tick(t);
+
   thread_wakeup();
   if (thread_prior_aging || thread_mlfqs)
     thread_aging();
 }
 
+/* Credits CNT timer ticks that went by without a timer
+   interrupt, while the CPU was halted, to the idle thread. */
+void thread_account_idle(int64_t cnt)
+{
+  idle_ticks += cnt;
+}
+
 /* Prints thread statistics. */
 void thread_print_stats()
 {
@@ -258,8 +335,13 @@ void thread_unblock(struct thread *t)
 
   old_level = intr_disable();
   ASSERT(t->status == THREAD_BLOCKED);
+  if (trace_enabled)
+    trace_unblock(t);
   //
-  list_insert_ordered(&ready_list, &t->elem, priority_comp, NULL);
+  if (thread_fair)
+    fair_enqueue(t, true);
+  else
+    list_insert_ordered(&ready_list, &t->elem, priority_comp, NULL);
   //
   t->status = THREAD_READY;
   intr_set_level(old_level);
@@ -325,13 +407,26 @@ void thread_yield()
   ASSERT(!intr_context());
   enum intr_level old_level = intr_disable();
   if (cur != idle_thread)
+  {
     //
-    list_insert_ordered(&ready_list, &cur->elem, priority_comp, NULL);
-  //
+    if (thread_fair)
+      fair_enqueue(cur, false);
+    else
+      list_insert_ordered(&ready_list, &cur->elem, priority_comp, NULL);
+    //
+  }
   cur->status = THREAD_READY;
   schedule();
   intr_set_level(old_level);
 }
+
+/* Yields the CPU on behalf of an interrupt handler that called
+   intr_yield_on_return().  Otherwise the same as thread_yield(). */
+void thread_preempt()
+{
+  preempting = true;
+  thread_yield();
+}
 //
 void thread_wakeup()
 {
@@ -345,6 +440,8 @@ void thread_wakeup()
       continue;
     }
     iter = list_remove(iter);
+    if (trace_enabled)
+      trace_wake(entry, entry->wakeup);
     thread_unblock(entry);
   }
 }
@@ -396,6 +493,28 @@ void thread_set_nice(int nice UNUSED)
 {
   struct thread *cur = thread_current();
   int cur_nice;
+
+  nice = (nice < NICE_MIN) ? NICE_MIN : nice;
+  nice = (nice > NICE_MAX) ? NICE_MAX : nice;
+
+  /* Under the fair-share scheduler NICE only changes the rate at
+     which virtual runtime accumulates from now on. */
+  if (thread_fair)
+  {
+    enum intr_level old_level = intr_disable();
+    bool preempt;
+
+    cur->nice = nice;
+    preempt = !heap_empty(&fair_queue) &&
+              heap_entry(heap_top(&fair_queue), struct thread,
+                         heap_elem)
+                      ->vruntime < cur->vruntime;
+    intr_set_level(old_level);
+
+    if (preempt)
+      thread_yield();
+    return;
+  }
   cur->nice = cur_nice = nice;
   int32_t recent_cpu = cur->recent_cpu;
 
@@ -478,6 +597,7 @@ void refresh_recent_cpu()
 
 void refresh_priority()
 {
+  bool blocked_changed = false;
   struct list_elem *iter = list_begin(&all_process_list);
   while (iter != list_end(&all_process_list))
   {
@@ -493,10 +613,14 @@ void refresh_priority()
     new_priority = (new_priority < PRI_MIN) ? PRI_MIN : new_priority;
     new_priority = (new_priority > PRI_MAX) ? PRI_MAX : new_priority;
 
+    if (entry->status == THREAD_BLOCKED && entry->priority != new_priority)
+      blocked_changed = true;
     entry->priority = new_priority;
 
     iter = list_next(iter);
   }
+  if (blocked_changed)
+    thread_priority_epoch++;
   struct thread *HPT = top_HPT(&ready_list);
   if (HPT == NULL)
     return;
@@ -527,6 +651,10 @@ idle(void *idle_started_ UNUSED)
     intr_disable();
     thread_block();
 
+    /* Nothing to run until the next interrupt, so in tickless
+       mode don't ask for one before it's needed. */
+    timer_idle_enter();
+
     /* Re-enable interrupts and wait for the next one.
 
        The `sti' instruction disables interrupts until the
@@ -642,32 +770,6 @@ struct thread *top_HPT(struct list *tmp_list)
   return HPT;
 }
 
-struct thread *pop_HPT(struct list *tmp_list)
-{
-  struct list_elem *h_iter = NULL;
-  struct thread *HPT = NULL;
-  int HPT_priority = PRI_MIN;
-
-  if (list_empty(tmp_list) == true)
-    return NULL;
-
-  for (struct list_elem *iter = list_begin(tmp_list);
-       iter != list_end(tmp_list);
-       iter = list_next(iter))
-  {
-    struct thread *entry = list_entry(iter, struct thread, elem);
-    if (HPT_priority > entry->priority)
-      continue;
-
-    HPT = entry;
-    h_iter = iter;
-    HPT_priority = entry->priority;
-  }
-  list_remove(h_iter);
-
-  return HPT;
-}
-
 /* Chooses and returns the next thread to be scheduled.  Should
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
@@ -676,6 +778,13 @@ struct thread *pop_HPT(struct list *tmp_list)
 static struct thread *
 next_thread_to_run()
 {
+  if (thread_fair)
+  {
+    if (heap_empty(&fair_queue))
+      return idle_thread;
+    return heap_entry(heap_pop(&fair_queue), struct thread, heap_elem);
+  }
+
   if (list_empty(&ready_list))
     return idle_thread;
   else
@@ -738,13 +847,25 @@ static void
 schedule()
 {
   struct thread *cur = running_thread();
-  struct thread *next = next_thread_to_run();
+  struct thread *next;
   struct thread *prev = NULL;
 
   ASSERT(intr_get_level() == INTR_OFF);
+
+  /* Bring `ticks' up to date and the periodic tick back before
+     anyone but the idle thread runs. */
+  timer_idle_exit();
+  next = next_thread_to_run();
   ASSERT(cur->status != THREAD_RUNNING);
   ASSERT(is_thread(next));
 
+  if (trace_enabled && cur != next)
+    trace_switch(cur, next, cur->status == THREAD_BLOCKED ? TRACE_BLOCK
+                            : cur->status == THREAD_DYING ? TRACE_EXIT
+                            : preempting                  ? TRACE_PREEMPT
+                                                          : TRACE_YIELD);
+  preempting = false;
+
   if (cur != next)
     prev = switch_threads(cur, next);
   thread_schedule_tail(prev);
@@ -764,6 +885,60 @@ allocate_tid()
   return tid;
 }
 
+/* Adds T to the fair run queue.  If T is WOKEN from a blocked
+   state, or is newly created, its virtual runtime is brought up
+   to no less than min_vruntime minus a bounded sleeper credit,
+   so it runs soon without being able to monopolize the CPU with
+   time it banked while asleep.  Interrupts must be off. */
+static void
+fair_enqueue(struct thread *t, bool woken)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (woken && t->vruntime < min_vruntime - FAIR_SLEEPER_CREDIT)
+    t->vruntime = min_vruntime - FAIR_SLEEPER_CREDIT;
+  heap_push(&fair_queue, &t->heap_elem);
+}
+
+/* Charges running thread T for one timer tick, weighted by its
+   nice value, and preempts it once a ready thread has fallen
+   far enough behind.  Runs in the timer interrupt. */
+static void
+fair_tick(struct thread *t)
+{
+  int weight = nice_to_weight[t->nice - NICE_MIN];
+  struct thread *next;
+
+  t->vruntime += VRUNTIME_SCALE * NICE_0_WEIGHT / weight;
+  fair_update_min_vruntime(t);
+
+  if (heap_empty(&fair_queue))
+    return;
+  next = heap_entry(heap_top(&fair_queue), struct thread, heap_elem);
+  if (t->vruntime - next->vruntime > FAIR_WAKEUP_GRAN)
+    intr_yield_on_return();
+}
+
+/* Advances min_vruntime to the least virtual runtime among the
+   running thread CUR and the ready threads.  It never moves
+   backward. */
+static void
+fair_update_min_vruntime(struct thread *cur)
+{
+  int64_t least = cur->vruntime;
+
+  if (!heap_empty(&fair_queue))
+  {
+    struct thread *next = heap_entry(heap_top(&fair_queue),
+                                     struct thread, heap_elem);
+    if (next->vruntime < least)
+      least = next->vruntime;
+  }
+
+  if (least > min_vruntime)
+    min_vruntime = least;
+}
+
 /* Offset of `stack' member within `struct thread'.
    Used by switch.S, which can't figure it out on its own. */
 uint32_t thread_stack_ofs = offsetof(struct thread, stack);
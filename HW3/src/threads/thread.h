@@ -2,6 +2,7 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <heap.h>
 #include <list.h>
 #include <stdint.h>
 #include <threads/synch.h>
@@ -81,11 +82,13 @@ typedef int tid_t;
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
 /* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+   the run queue (thread.c), or it can be an element in the
+   sleeping thread list (timer.c).  Likewise, `heap_elem' is used
+   both for the fair-share run queue (thread.c) and for semaphore
+   wait heaps (synch.c).  Each can be used two ways only because
+   the uses are mutually exclusive: only a thread in the ready
+   state is on a run queue, whereas only a thread in the blocked
+   state sleeps or waits on a semaphore. */
 struct thread
 {
    /* Owned by thread.c. */
@@ -101,6 +104,10 @@ struct thread
    int32_t recent_cpu;
    int nice;
 
+   /* Fair-share scheduler. */
+   struct heap_elem heap_elem; /* Fair run queue or semaphore wait heap. */
+   int64_t vruntime;           /* Weighted virtual runtime. */
+
 #ifdef USERPROG
    /* Owned by userprog/process.c. */
    uint32_t *pagedir; /* Page directory. */
@@ -121,10 +128,21 @@ extern bool thread_prior_aging;
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* Incremented whenever the priority of a blocked thread
+   changes, so that semaphore and condition variable wait heaps
+   know to reorder themselves. */
+extern unsigned thread_priority_epoch;
+
+/* If true, use the fair-share scheduler, which always runs the
+   ready thread with the least weighted virtual runtime.
+   Controlled by kernel command-line option "-o fair". */
+extern bool thread_fair;
+
 void thread_init();
 void thread_start();
 
 void thread_tick();
+void thread_account_idle(int64_t cnt);
 void thread_print_stats();
 
 typedef void thread_func(void *aux);
@@ -139,6 +157,7 @@ const char *thread_name();
 
 void thread_exit() NO_RETURN;
 void thread_yield();
+void thread_preempt();
 void thread_wakeup();
 void thread_aging();
 typedef void thread_action_func(struct thread *t, void *aux);
@@ -152,7 +171,6 @@ int thread_get_load_avg();
 void refresh_load_avg();
 void refresh_recent_cpu();
 void refresh_priority();
-struct thread *pop_HPT(struct list *_list_);
 struct thread *top_HPT(struct list *_list_);
 bool priority_comp(const struct list_elem *, const struct list_elem *);
 
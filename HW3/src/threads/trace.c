@@ -0,0 +1,178 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Scheduler event trace.
+
+   Every context switch, wakeup, and timer sleep is appended to a
+   ring buffer allocated once at boot, overwriting the oldest
+   events when it fills up.  All events are recorded with
+   interrupts off, which on a uniprocessor is all it takes to
+   append without a lock.  At shutdown, trace_dump() prints the
+   buffer for utils/sched-trace to analyze.
+
+   Events are timestamped with the CPU's time-stamp counter.
+   trace_dump() reports its rate, measured against the timer
+   over the whole run, so that timestamps can be converted to
+   real time. */
+
+bool trace_enabled;
+
+/* Event types. */
+enum trace_type
+  {
+    TRACE_SWITCH,               /* Switched from tid A to tid B. */
+    TRACE_UNBLOCK,              /* Made tid A ready. */
+    TRACE_SLEEP,                /* Tid A sleeps until tick B. */
+    TRACE_WAKE                  /* Woke tid A, which slept until tick B. */
+  };
+
+/* A recorded event. */
+struct trace_event
+  {
+    uint64_t tsc;               /* Time-stamp counter. */
+    int32_t tick;               /* Timer tick. */
+    int32_t a, b;               /* Depends on `type'. */
+    uint8_t type;               /* A trace_type. */
+    uint8_t reason;             /* A trace_reason, for TRACE_SWITCH. */
+    uint8_t priority;           /* Priority of tid B for TRACE_SWITCH,
+                                   of tid A otherwise. */
+  };
+
+/* Size of the trace buffer. */
+#define TRACE_PAGE_CNT 32
+#define TRACE_EVENT_CNT (TRACE_PAGE_CNT * PGSIZE / sizeof (struct trace_event))
+
+static struct trace_event *events;  /* Ring buffer. */
+static uint32_t event_cnt;          /* # of events ever recorded. */
+static uint64_t start_tsc;          /* TSC when tracing started. */
+static int64_t start_tick;          /* Timer tick when tracing started. */
+
+static const char *type_names[] = {"switch", "unblock", "sleep", "wake"};
+static const char *reason_names[] = {"yield", "preempt", "block", "exit"};
+
+/* Reads the time-stamp counter. */
+static inline uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Allocates the trace buffer, if tracing is enabled.  Must be
+   called after palloc_init(). */
+void
+trace_init (void) 
+{
+  if (!trace_enabled)
+    return;
+
+  events = palloc_get_multiple (0, TRACE_PAGE_CNT);
+  if (events == NULL)
+    {
+      printf ("trace: not enough memory for trace buffer\n");
+      trace_enabled = false;
+      return;
+    }
+  start_tsc = rdtsc ();
+  start_tick = timer_ticks ();
+}
+
+/* Appends an event to the trace buffer. */
+static void
+record (enum trace_type type, enum trace_reason reason, int priority,
+        int32_t a, int32_t b) 
+{
+  struct trace_event *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  if (events == NULL)
+    return;
+
+  e = &events[event_cnt++ % TRACE_EVENT_CNT];
+  e->tsc = rdtsc ();
+  e->tick = timer_ticks ();
+  e->a = a;
+  e->b = b;
+  e->type = type;
+  e->reason = reason;
+  e->priority = priority;
+}
+
+/* Records a switch from PREV to NEXT, which happened for
+   REASON. */
+void
+trace_switch (const struct thread *prev, const struct thread *next,
+              enum trace_reason reason) 
+{
+  record (TRACE_SWITCH, reason, next->priority, prev->tid, next->tid);
+}
+
+/* Records that T was made ready to run. */
+void
+trace_unblock (const struct thread *t) 
+{
+  record (TRACE_UNBLOCK, 0, t->priority, t->tid, 0);
+}
+
+/* Records that T went to sleep until timer tick WAKEUP. */
+void
+trace_sleep (const struct thread *t, int64_t wakeup) 
+{
+  record (TRACE_SLEEP, 0, t->priority, t->tid, wakeup);
+}
+
+/* Records that T, which slept until timer tick WAKEUP, was
+   woken. */
+void
+trace_wake (const struct thread *t, int64_t wakeup) 
+{
+  record (TRACE_WAKE, 0, t->priority, t->tid, wakeup);
+}
+
+/* Prints the trace buffer, oldest event first. */
+void
+trace_dump (void) 
+{
+  enum intr_level old_level;
+  struct trace_event *buf;
+  uint32_t first, i;
+  uint64_t hz = 0;
+  int64_t ticks;
+
+  if (!trace_enabled || events == NULL)
+    return;
+
+  /* Stop recording, so that the events being printed are not
+     overwritten by the scheduling that printing causes. */
+  old_level = intr_disable ();
+  buf = events;
+  events = NULL;
+  ticks = timer_ticks () - start_tick;
+  if (ticks > 0)
+    hz = (rdtsc () - start_tsc) * TIMER_FREQ / ticks;
+  intr_set_level (old_level);
+
+  first = event_cnt > TRACE_EVENT_CNT ? event_cnt - TRACE_EVENT_CNT : 0;
+
+  printf ("Trace: %"PRIu32" events, %"PRIu32" overwritten, "
+          "%"PRIu64" cycles/s, %d ticks/s\n",
+          event_cnt, first, hz, TIMER_FREQ);
+  for (i = first; i != event_cnt; i++)
+    {
+      struct trace_event *e = &buf[i % TRACE_EVENT_CNT];
+      printf ("trace %"PRIu64" %"PRId32" %s %"PRId32" %"PRId32" %u",
+              e->tsc - start_tsc, e->tick, type_names[e->type],
+              e->a, e->b, e->priority);
+      if (e->type == TRACE_SWITCH)
+        printf (" %s", reason_names[e->reason]);
+      printf ("\n");
+    }
+}
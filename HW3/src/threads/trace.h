@@ -0,0 +1,30 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
+
+/* Why a thread gave up the CPU. */
+enum trace_reason
+  {
+    TRACE_YIELD,                /* Called thread_yield(). */
+    TRACE_PREEMPT,              /* Preempted at the end of an interrupt. */
+    TRACE_BLOCK,                /* Blocked. */
+    TRACE_EXIT                  /* Exited. */
+  };
+
+/* If true, record scheduler events in the trace buffer.
+   Controlled by kernel command-line option "-trace". */
+extern bool trace_enabled;
+
+void trace_init (void);
+void trace_switch (const struct thread *prev, const struct thread *next,
+                   enum trace_reason);
+void trace_unblock (const struct thread *);
+void trace_sleep (const struct thread *, int64_t wakeup);
+void trace_wake (const struct thread *, int64_t wakeup);
+void trace_dump (void);
+
+#endif /* threads/trace.h */
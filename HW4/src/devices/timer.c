@@ -1,10 +1,14 @@
 #include "devices/timer.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stdio.h>
+#include <timepage.h>
 #include "devices/pit.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
   
@@ -20,21 +24,52 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* Threads sleeping in timer_sleep(), soonest wakeup first.
+   Accessed with interrupts off. */
+static struct list sleep_list;
+
+/* A thread blocked in timer_sema_down(). */
+struct sema_timeout
+  {
+    struct list_elem elem;      /* Element in timeout_list. */
+    int64_t wakeup;             /* Tick to give up at. */
+    struct thread *thread;      /* The blocked thread. */
+    bool expired;               /* Removed from timeout_list? */
+  };
+
+/* Threads blocked in timer_sema_down(), soonest deadline first.
+   Accessed with interrupts off. */
+static struct list timeout_list;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Number of timer ticks to measure the TSC frequency over. */
+#define TSC_CALIBRATE_TICKS 4
+
+/* TSC calibration, shared read-only with user processes.
+   Initialized by timer_calibrate(). */
+static struct timepage *timepage;
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static bool wakeup_less (const struct list_elem *, const struct list_elem *,
+                         void *aux);
+static bool timeout_less (const struct list_elem *, const struct list_elem *,
+                          void *aux);
+static uint64_t calibrate_tsc (void);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void) 
 {
+  list_init (&sleep_list);
+  list_init (&timeout_list);
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -44,6 +79,7 @@ void
 timer_calibrate (void) 
 {
   unsigned high_bit, test_bit;
+  uint64_t tsc_hz;
 
   ASSERT (intr_get_level () == INTR_ON);
   printf ("Calibrating timer...  ");
@@ -64,6 +100,29 @@ timer_calibrate (void)
       loops_per_tick |= test_bit;
 
   printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+  tsc_hz = calibrate_tsc ();
+  if (tsc_hz != 0)
+    printf ("TSC runs at %'"PRIu64" Hz.\n", tsc_hz);
+  else
+    printf ("Couldn't calibrate TSC, timer_ns() will return 0.\n");
+}
+
+/* Returns the number of nanoseconds since the clock was
+   calibrated at boot, or 0 before then. */
+int64_t
+timer_ns (void) 
+{
+  return timepage != NULL ? timepage_ns (timepage) : 0;
+}
+
+/* Returns the kernel page holding the clock calibration, for
+   mapping into user processes at TIMEPAGE, or a null pointer if
+   the clock is not calibrated. */
+void *
+timer_timepage (void) 
+{
+  return timepage;
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -85,15 +144,56 @@ timer_elapsed (int64_t then)
 }
 
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
-   be turned on. */
+   be turned on.  The thread is blocked meanwhile, so that the
+   CPU can idle or run other threads. */
 void
 timer_sleep (int64_t ticks) 
 {
-  int64_t start = timer_ticks ();
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks) 
-    thread_yield ();
+  if (ticks <= 0)
+    return;
+
+  old_level = intr_disable ();
+  cur->wakeup = timer_ticks () + ticks;
+  list_insert_ordered (&sleep_list, &cur->elem, wakeup_less, NULL);
+  thread_block ();
+  intr_set_level (old_level);
+}
+
+/* Downs SEMA like sema_down(), but gives up after approximately
+   TICKS timer ticks.  Returns true if SEMA was downed, false if
+   the time ran out first.  Interrupts must be turned on.  The
+   thread is blocked meanwhile, as in timer_sleep(). */
+bool
+timer_sema_down (struct semaphore *sema, int64_t ticks) 
+{
+  struct sema_timeout st;
+  enum intr_level old_level;
+  bool success;
+
+  ASSERT (sema != NULL);
+  ASSERT (intr_get_level () == INTR_ON);
+
+  old_level = intr_disable ();
+  if (sema->value == 0 && ticks > 0)
+    {
+      st.wakeup = timer_ticks () + ticks;
+      st.thread = thread_current ();
+      st.expired = false;
+      list_insert_ordered (&timeout_list, &st.elem, timeout_less, NULL);
+      list_push_back (&sema->waiters, &st.thread->elem);
+      thread_block ();
+      if (!st.expired)
+        list_remove (&st.elem);
+    }
+  success = sema->value > 0;
+  if (success)
+    sema->value--;
+  intr_set_level (old_level);
+  return success;
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -168,10 +268,42 @@ timer_print_stats (void)
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
 {
   ticks++;
-  thread_tick ();
+
+  /* Wake up the sleepers whose time has come. */
+  while (!list_empty (&sleep_list))
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->wakeup > ticks)
+        break;
+      list_pop_front (&sleep_list);
+      thread_unblock (t);
+    }
+
+  /* Take the threads whose time has run out off their semaphores.
+     One that sema_up() has already unblocked is no longer blocked,
+     and will find its semaphore's value nonzero. */
+  while (!list_empty (&timeout_list))
+    {
+      struct sema_timeout *st = list_entry (list_front (&timeout_list),
+                                            struct sema_timeout, elem);
+      if (st->wakeup > ticks)
+        break;
+      list_pop_front (&timeout_list);
+      st->expired = true;
+      if (st->thread->status == THREAD_BLOCKED)
+        {
+          list_remove (&st->thread->elem);
+          thread_unblock (st->thread);
+        }
+    }
+
+  if (profile_enabled)
+    profile_sample (args);
+  thread_tick ((args->cs & 3) == 3);
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -235,6 +367,73 @@ real_time_sleep (int64_t num, int32_t denom)
     }
 }
 
+/* Measures the TSC frequency against the timer interrupt and
+   sets up the time page from it.  Returns the frequency in Hz,
+   or 0 if it could not be measured. */
+static uint64_t
+calibrate_tsc (void) 
+{
+  uint64_t tsc_start, hz, mult;
+  int64_t start;
+  unsigned shift;
+
+  timepage = palloc_get_page (PAL_ZERO);
+  if (timepage == NULL)
+    return 0;
+
+  /* Start on a tick boundary. */
+  start = ticks;
+  while (ticks == start)
+    barrier ();
+
+  tsc_start = rdtsc ();
+  start = ticks;
+  while (ticks - start < TSC_CALIBRATE_TICKS)
+    barrier ();
+  hz = (rdtsc () - tsc_start) * TIMER_FREQ / TSC_CALIBRATE_TICKS;
+  if (hz == 0)
+    {
+      palloc_free_page (timepage);
+      timepage = NULL;
+      return 0;
+    }
+
+  /* Pick the largest shift for which the multiplier still fits
+     in 32 bits, for the most precision. */
+  for (shift = 32; ; shift--)
+    {
+      mult = ((uint64_t) 1000000000 << shift) / hz;
+      if (mult <= UINT32_MAX || shift == 0)
+        break;
+    }
+  timepage->mult = mult;
+  timepage->shift = shift;
+  timepage->tsc_base = tsc_start;
+  return hz;
+}
+
+/* Returns true if sleeping thread A wakes up before B. */
+static bool
+wakeup_less (const struct list_elem *a_, const struct list_elem *b_,
+             void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->wakeup < b->wakeup;
+}
+
+/* Returns true if timeout A runs out before B. */
+static bool
+timeout_less (const struct list_elem *a_, const struct list_elem *b_,
+              void *aux UNUSED)
+{
+  const struct sema_timeout *a = list_entry (a_, struct sema_timeout, elem);
+  const struct sema_timeout *b = list_entry (b_, struct sema_timeout, elem);
+
+  return a->wakeup < b->wakeup;
+}
+
 /* Busy-wait for approximately NUM/DENOM seconds. */
 static void
 real_time_delay (int64_t num, int32_t denom)
@@ -2,8 +2,11 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
+struct semaphore;
+
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
@@ -13,11 +16,16 @@ void timer_calibrate (void);
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
 
+/* High-resolution clock. */
+int64_t timer_ns (void);
+void *timer_timepage (void);
+
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
+bool timer_sema_down (struct semaphore *, int64_t ticks);
 
 /* Busy waits. */
 void timer_mdelay (int64_t milliseconds);
@@ -0,0 +1,425 @@
+#include "filesys/cache.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/filesys.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "threads/workqueue.h"
+
+/* Buffer cache.
+
+   Keeps the CACHE_CNT most useful sectors of the file system
+   device in memory.  Writes only dirty the cached copy.  A
+   flusher thread writes dirty sectors back every FLUSH_INTERVAL
+   ticks, in ascending sector order so that the disk head sweeps
+   across them once, and with one request for each run of up to
+   FLUSH_RUN_MAX consecutive sectors.  A slot is also written back when it is
+   reused, and all of them at cache_flush().  Slots are reused
+   in clock order, giving each recently accessed sector a second
+   chance.
+
+   No more than DIRTY_MAX slots may be dirty at once.  A writer
+   that finds that many flushes the cache down to half as many
+   itself before its write goes ahead, so that a heavy writer
+   pays for its own write-back instead of filling the cache with
+   dirty sectors that every other thread must wait on when it
+   needs a slot.
+
+   cache_lock protects the mapping from sectors to slots and the
+   clock hand.  Each slot's own lock protects its data and is
+   held across the disk I/O that fills or writes back the slot,
+   so that cache_lock is never held while waiting for the
+   disk.
+
+   cache_readahead() queues sectors that are likely to be read
+   soon.  A work queue worker reads them into the cache in the
+   background, so that the disk works while the reader is still
+   copying out earlier data.
+
+   Most disk I/O thus happens in the flusher, the read-ahead
+   workers, or whichever thread needs a slot, so block reads and
+   writes are charged to the thread that causes them instead: a
+   read to the thread whose cache_read() or cache_write() misses,
+   a write to the thread whose cache_write() dirties a clean
+   slot.  Read-ahead is not charged to anyone. */
+
+/* Number of cached sectors. */
+#define CACHE_CNT 64
+
+/* Most slots that may be dirty at once. */
+#define DIRTY_MAX (CACHE_CNT * 3 / 4)
+
+/* Timer ticks between runs of the flusher thread. */
+#define FLUSH_INTERVAL TIMER_FREQ
+
+/* Most consecutive sectors that flush() writes with one
+   request. */
+#define FLUSH_RUN_MAX (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* A cache slot. */
+struct cache_entry
+  {
+    struct lock lock;           /* Protects data and dirty. */
+    block_sector_t sector;      /* Cached sector, if in_use. */
+    bool in_use;                /* Holds a sector? */
+    bool accessed;              /* Used since the clock hand passed? */
+    bool dirty;                 /* Modified since read from disk? */
+    uint8_t *data;              /* BLOCK_SECTOR_SIZE bytes. */
+  };
+
+static struct cache_entry cache[CACHE_CNT];
+static struct lock cache_lock;  /* Protects sector, in_use, hand. */
+static size_t hand;             /* Clock hand, an index into cache. */
+static unsigned dirty_cnt;      /* # of dirty slots. */
+
+/* Sectors queued for read-ahead, a ring protected by
+   cache_lock.  Requests that find it full are dropped. */
+#define READAHEAD_CNT 32
+static block_sector_t readahead_queue[READAHEAD_CNT];
+static unsigned readahead_head;     /* # of sectors taken. */
+static unsigned readahead_tail;     /* # of sectors queued. */
+static struct work readahead_work;  /* Drains the queue. */
+
+/* Statistics. */
+static unsigned long long hit_cnt, miss_cnt, write_back_cnt;
+static unsigned long long readahead_cnt;
+
+static void readahead (struct work *);
+static void flush (unsigned target);
+static thread_func flusher NO_RETURN;
+
+/* Initializes the buffer cache. */
+void
+cache_init (void)
+{
+  uint8_t *pages;
+  size_t i;
+
+  pages = palloc_get_multiple (PAL_ASSERT,
+                               CACHE_CNT * BLOCK_SECTOR_SIZE / PGSIZE);
+  lock_init (&cache_lock);
+  lock_register (&cache_lock, "cache_lock");
+  for (i = 0; i < CACHE_CNT; i++)
+    {
+      struct cache_entry *e = &cache[i];
+      lock_init (&e->lock);
+      e->in_use = false;
+      e->data = pages + i * BLOCK_SECTOR_SIZE;
+    }
+  work_init (&readahead_work, readahead);
+  if (thread_create ("flusher", PRI_DEFAULT, flusher, NULL) == TID_ERROR)
+    PANIC ("couldn't start buffer cache flusher");
+}
+
+/* Sets E's dirty bit to DIRTY, keeping dirty_cnt up to date.
+   E's lock must be held. */
+static void
+set_dirty (struct cache_entry *e, bool dirty)
+{
+  ASSERT (lock_held_by_current_thread (&e->lock));
+
+  if (e->dirty != dirty)
+    {
+      lock_acquire (&cache_lock);
+      if (dirty)
+        dirty_cnt++;
+      else
+        dirty_cnt--;
+      lock_release (&cache_lock);
+      e->dirty = dirty;
+    }
+}
+
+/* Writes E back to disk if it is dirty.  E's lock must be
+   held. */
+static void
+write_back (struct cache_entry *e)
+{
+  ASSERT (lock_held_by_current_thread (&e->lock));
+
+  if (e->dirty)
+    {
+      block_write (fs_device, e->sector, e->data);
+      set_dirty (e, false);
+      write_back_cnt++;
+    }
+}
+
+/* Returns the slot that caches SECTOR, with its lock held.  If
+   SECTOR is not cached, reuses a slot for it, reading SECTOR
+   from disk only if LOAD is true, since a caller about to
+   overwrite the whole sector does not need its old contents.
+   Counts the lookup as a read-ahead if READAHEAD is true,
+   otherwise as a hit or a miss. */
+static struct cache_entry *
+lookup (block_sector_t sector, bool load, bool readahead)
+{
+  for (;;)
+    {
+      struct cache_entry *e;
+      size_t i;
+
+      /* Look for SECTOR in the cache. */
+      lock_acquire (&cache_lock);
+      for (i = 0; i < CACHE_CNT; i++)
+        if (cache[i].in_use && cache[i].sector == sector)
+          break;
+      if (i < CACHE_CNT)
+        {
+          e = &cache[i];
+          if (!readahead)
+            hit_cnt++;
+          lock_release (&cache_lock);
+
+          /* The slot may have been reused while we waited. */
+          lock_acquire (&e->lock);
+          if (e->in_use && e->sector == sector)
+            {
+              e->accessed = true;
+              return e;
+            }
+          lock_release (&e->lock);
+          continue;
+        }
+
+      /* Advance the clock hand to a slot that is not in use by
+         anyone else and has not been accessed recently.  Two
+         full sweeps suffice, because the first one clears every
+         accessed bit. */
+      e = NULL;
+      for (i = 0; i < 2 * CACHE_CNT; i++)
+        {
+          struct cache_entry *victim = &cache[hand];
+          hand = (hand + 1) % CACHE_CNT;
+          if (!lock_try_acquire (&victim->lock))
+            continue;
+          if (victim->in_use && victim->accessed)
+            {
+              victim->accessed = false;
+              lock_release (&victim->lock);
+              continue;
+            }
+          e = victim;
+          break;
+        }
+      if (e == NULL)
+        {
+          /* Every slot is busy.  Let their holders finish. */
+          lock_release (&cache_lock);
+          thread_yield ();
+          continue;
+        }
+
+      if (e->in_use && e->dirty)
+        {
+          /* Write back without holding cache_lock.  The slot
+             still maps its old sector meanwhile, so readers of
+             that sector wait for us instead of reading stale
+             data from disk.  Then start over, since SECTOR may
+             have been cached in the meantime. */
+          lock_release (&cache_lock);
+          write_back (e);
+          lock_release (&e->lock);
+          continue;
+        }
+
+      /* Claim the clean slot for SECTOR, then fill it.  Anyone
+         who finds SECTOR in the meantime waits for our lock. */
+      e->sector = sector;
+      e->in_use = true;
+      e->accessed = true;
+      e->dirty = false;
+      if (readahead)
+        readahead_cnt++;
+      else
+        miss_cnt++;
+      lock_release (&cache_lock);
+      if (load)
+        {
+          block_read (fs_device, sector, e->data);
+          if (!readahead)
+            thread_current ()->rusage.block_reads++;
+        }
+      return e;
+    }
+}
+
+/* Reads SIZE bytes starting at byte OFS of SECTOR into
+   BUFFER. */
+void
+cache_read (block_sector_t sector, void *buffer, off_t ofs, off_t size)
+{
+  struct cache_entry *e;
+
+  ASSERT (ofs >= 0 && size >= 0 && ofs + size <= BLOCK_SECTOR_SIZE);
+
+  e = lookup (sector, true, false);
+  memcpy (buffer, e->data + ofs, size);
+  lock_release (&e->lock);
+}
+
+/* Writes SIZE bytes from BUFFER into SECTOR, starting at byte
+   OFS.  The write reaches the disk when the sector is evicted
+   or at the next cache_flush(). */
+void
+cache_write (block_sector_t sector, const void *buffer, off_t ofs,
+             off_t size)
+{
+  struct cache_entry *e;
+
+  ASSERT (ofs >= 0 && size >= 0 && ofs + size <= BLOCK_SECTOR_SIZE);
+
+  if (dirty_cnt >= DIRTY_MAX)
+    flush (DIRTY_MAX / 2);
+
+  e = lookup (sector, size < BLOCK_SECTOR_SIZE, false);
+  memcpy (e->data + ofs, buffer, size);
+  if (!e->dirty)
+    thread_current ()->rusage.block_writes++;
+  set_dirty (e, true);
+  lock_release (&e->lock);
+}
+
+/* Queues SECTOR to be read into the cache in the background. */
+void
+cache_readahead (block_sector_t sector)
+{
+  lock_acquire (&cache_lock);
+  if (readahead_tail - readahead_head < READAHEAD_CNT)
+    readahead_queue[readahead_tail++ % READAHEAD_CNT] = sector;
+  lock_release (&cache_lock);
+  workqueue_submit (&readahead_work, WORK_LOW);
+}
+
+/* Reads the sectors queued by cache_readahead() into the cache,
+   until the queue is empty. */
+static void
+readahead (struct work *w UNUSED)
+{
+  for (;;)
+    {
+      struct cache_entry *e;
+      block_sector_t sector;
+
+      lock_acquire (&cache_lock);
+      if (readahead_head == readahead_tail)
+        {
+          lock_release (&cache_lock);
+          return;
+        }
+      sector = readahead_queue[readahead_head++ % READAHEAD_CNT];
+      lock_release (&cache_lock);
+
+      e = lookup (sector, true, true);
+      lock_release (&e->lock);
+    }
+}
+
+/* Writes dirty sectors back to disk in ascending sector order,
+   until no more than TARGET slots are dirty. */
+static void
+flush (unsigned target)
+{
+  struct cache_entry *dirty[CACHE_CNT];
+  size_t dirty_slots = 0;
+  uint8_t *buf;
+  size_t i;
+
+  /* Collect the dirty slots and sort them by sector. */
+  lock_acquire (&cache_lock);
+  for (i = 0; i < CACHE_CNT; i++)
+    if (cache[i].in_use && cache[i].dirty)
+      {
+        size_t j = dirty_slots++;
+        for (; j > 0 && dirty[j - 1]->sector > cache[i].sector; j--)
+          dirty[j] = dirty[j - 1];
+        dirty[j] = &cache[i];
+      }
+  lock_release (&cache_lock);
+
+  /* Write each run of slots that cache consecutive sectors with
+     a single request, gathering their data in BUF.  Without BUF,
+     write them one by one. */
+  buf = palloc_get_page (0);
+  i = 0;
+  while (i < dirty_slots && dirty_cnt > target)
+    {
+      struct cache_entry *run[FLUSH_RUN_MAX];
+      size_t run_cnt = 0;
+      size_t j;
+
+      lock_acquire (&dirty[i]->lock);
+      run[run_cnt++] = dirty[i++];
+      if (!run[0]->in_use || !run[0]->dirty)
+        {
+          lock_release (&run[0]->lock);
+          continue;
+        }
+
+      /* Extend the run.  Other flushers may be locking the same
+         slots in a different order if they were reused since we
+         sorted them, so never wait for a lock while holding
+         one. */
+      while (buf != NULL && run_cnt < FLUSH_RUN_MAX && i < dirty_slots
+             && lock_try_acquire (&dirty[i]->lock))
+        {
+          struct cache_entry *e = dirty[i];
+          if (!e->in_use || !e->dirty
+              || e->sector != run[0]->sector + run_cnt)
+            {
+              lock_release (&e->lock);
+              break;
+            }
+          run[run_cnt++] = e;
+          i++;
+        }
+
+      if (run_cnt == 1)
+        write_back (run[0]);
+      else
+        {
+          for (j = 0; j < run_cnt; j++)
+            memcpy (buf + j * BLOCK_SECTOR_SIZE, run[j]->data,
+                    BLOCK_SECTOR_SIZE);
+          block_write_multi (fs_device, run[0]->sector, run_cnt, buf);
+          for (j = 0; j < run_cnt; j++)
+            set_dirty (run[j], false);
+          write_back_cnt += run_cnt;
+        }
+      for (j = 0; j < run_cnt; j++)
+        lock_release (&run[j]->lock);
+    }
+  palloc_free_page (buf);
+}
+
+/* Writes every dirty sector back to disk. */
+void
+cache_flush (void)
+{
+  flush (0);
+}
+
+/* Flusher thread.  Periodically writes back all dirty
+   sectors. */
+static void
+flusher (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_sleep (FLUSH_INTERVAL);
+      flush (0);
+    }
+}
+
+/* Prints buffer cache statistics. */
+void
+cache_print_stats (void)
+{
+  printf ("Buffer cache: %llu hits, %llu misses, %llu read ahead, "
+          "%llu write-backs\n",
+          hit_cnt, miss_cnt, readahead_cnt, write_back_cnt);
+}
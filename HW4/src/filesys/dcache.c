@@ -0,0 +1,218 @@
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/synch.h"
+
+/* Directory entry cache.
+
+   Remembers what recent lookups of a name in a directory found:
+   the sector of the named inode and whether it is a directory,
+   or, in a negative entry, that there is no such name.  A path
+   whose components are all cached resolves without opening
+   any of the directories along it.
+
+   Entries are keyed by the sector of the directory's inode and
+   the name.  directory.c invalidates the entry for a name
+   whenever it adds or removes that name, and every entry of a
+   directory when a new directory is created in its sector, so
+   no entry outlives what it describes.
+
+   The DCACHE_CNT entries are reused in least recently used
+   order. */
+
+/* Number of cached entries. */
+#define DCACHE_CNT 128
+
+/* A cached directory entry. */
+struct dentry
+  {
+    struct hash_elem hash_elem;         /* Element in dentry_table. */
+    struct list_elem list_elem;         /* Element in lru_list. */
+    bool in_use;                        /* In dentry_table? */
+    block_sector_t dir;                 /* Directory's inode sector. */
+    char name[NAME_MAX + 1];            /* Name within the directory. */
+    block_sector_t sector;              /* Named inode, 0 if none. */
+    bool is_dir;                        /* Names a directory? */
+  };
+
+static struct dentry dentries[DCACHE_CNT];
+static struct hash dentry_table;    /* Entries in use, by dir and name. */
+static struct list lru_list;        /* Least recently used first. */
+static struct lock dcache_lock;     /* Protects all of the above. */
+
+/* Statistics. */
+static unsigned long long hit_cnt, negative_cnt, miss_cnt;
+
+static hash_hash_func dentry_hash;
+static hash_less_func dentry_less;
+
+/* Initializes the directory entry cache. */
+void
+dcache_init (void)
+{
+  size_t i;
+
+  if (!hash_init (&dentry_table, dentry_hash, dentry_less, NULL))
+    PANIC ("couldn't allocate directory entry cache");
+  list_init (&lru_list);
+  for (i = 0; i < DCACHE_CNT; i++)
+    {
+      dentries[i].in_use = false;
+      list_push_back (&lru_list, &dentries[i].list_elem);
+    }
+  lock_init (&dcache_lock);
+  lock_register (&dcache_lock, "dcache_lock");
+}
+
+/* Returns a hash value for dentry E. */
+static unsigned
+dentry_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct dentry *d = hash_entry (e, struct dentry, hash_elem);
+  return hash_string (d->name) ^ hash_int (d->dir);
+}
+
+/* Returns true if dentry A precedes dentry B. */
+static bool
+dentry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct dentry *a = hash_entry (a_, struct dentry, hash_elem);
+  const struct dentry *b = hash_entry (b_, struct dentry, hash_elem);
+
+  if (a->dir != b->dir)
+    return a->dir < b->dir;
+  return strcmp (a->name, b->name) < 0;
+}
+
+/* Returns the entry for NAME in directory DIR, or a null
+   pointer if there is none.  dcache_lock must be held. */
+static struct dentry *
+find (block_sector_t dir, const char *name)
+{
+  struct dentry key;
+  struct hash_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&dcache_lock));
+
+  if (strlen (name) > NAME_MAX)
+    return NULL;
+  key.dir = dir;
+  strlcpy (key.name, name, sizeof key.name);
+  e = hash_find (&dentry_table, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct dentry, hash_elem) : NULL;
+}
+
+/* Drops D from the cache, making it the next entry to reuse.
+   dcache_lock must be held. */
+static void
+discard (struct dentry *d)
+{
+  ASSERT (lock_held_by_current_thread (&dcache_lock));
+
+  hash_delete (&dentry_table, &d->hash_elem);
+  d->in_use = false;
+  list_remove (&d->list_elem);
+  list_push_front (&lru_list, &d->list_elem);
+}
+
+/* Looks up NAME in directory DIR.  If the result is cached,
+   returns true and sets *SECTORP to the sector of the inode
+   that NAME refers to, or to 0 if DIR has no entry for NAME,
+   and *IS_DIRP, if IS_DIRP is non-null, to whether that inode
+   is a directory.  Otherwise, returns false. */
+bool
+dcache_lookup (block_sector_t dir, const char *name,
+               block_sector_t *sectorp, bool *is_dirp)
+{
+  struct dentry *d;
+
+  lock_acquire (&dcache_lock);
+  d = find (dir, name);
+  if (d != NULL)
+    {
+      list_remove (&d->list_elem);
+      list_push_back (&lru_list, &d->list_elem);
+      *sectorp = d->sector;
+      if (is_dirp != NULL)
+        *is_dirp = d->is_dir;
+      if (d->sector != 0)
+        hit_cnt++;
+      else
+        negative_cnt++;
+    }
+  else
+    miss_cnt++;
+  lock_release (&dcache_lock);
+
+  return d != NULL;
+}
+
+/* Records that NAME in directory DIR refers to the inode in
+   SECTOR, which is a directory if IS_DIR is true, or, if SECTOR
+   is 0, that DIR has no entry for NAME. */
+void
+dcache_insert (block_sector_t dir, const char *name,
+               block_sector_t sector, bool is_dir)
+{
+  struct dentry *d;
+
+  if (strlen (name) > NAME_MAX)
+    return;
+
+  lock_acquire (&dcache_lock);
+  d = find (dir, name);
+  if (d == NULL)
+    {
+      d = list_entry (list_front (&lru_list), struct dentry, list_elem);
+      if (d->in_use)
+        hash_delete (&dentry_table, &d->hash_elem);
+      d->in_use = true;
+      d->dir = dir;
+      strlcpy (d->name, name, sizeof d->name);
+      hash_insert (&dentry_table, &d->hash_elem);
+    }
+  d->sector = sector;
+  d->is_dir = is_dir;
+  list_remove (&d->list_elem);
+  list_push_back (&lru_list, &d->list_elem);
+  lock_release (&dcache_lock);
+}
+
+/* Forgets what is cached about NAME in directory DIR. */
+void
+dcache_invalidate (block_sector_t dir, const char *name)
+{
+  struct dentry *d;
+
+  lock_acquire (&dcache_lock);
+  d = find (dir, name);
+  if (d != NULL)
+    discard (d);
+  lock_release (&dcache_lock);
+}
+
+/* Forgets everything cached about directory DIR. */
+void
+dcache_invalidate_dir (block_sector_t dir)
+{
+  size_t i;
+
+  lock_acquire (&dcache_lock);
+  for (i = 0; i < DCACHE_CNT; i++)
+    if (dentries[i].in_use && dentries[i].dir == dir)
+      discard (&dentries[i]);
+  lock_release (&dcache_lock);
+}
+
+/* Prints directory entry cache statistics. */
+void
+dcache_print_stats (void)
+{
+  printf ("Dentry cache: %llu hits, %llu negative hits, %llu misses\n",
+          hit_cnt, negative_cnt, miss_cnt);
+}
@@ -1,7 +1,9 @@
 #include "filesys/directory.h"
 #include <stdio.h>
 #include <string.h>
+#include <hash.h>
 #include <list.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
@@ -10,6 +12,7 @@
 struct dir 
   {
     struct inode *inode;                /* Backing store. */
+    struct dir_index *index;            /* Index of its entries. */
     off_t pos;                          /* Current position. */
   };
 
@@ -21,12 +24,93 @@ struct dir_entry
     bool in_use;                        /* In use or free? */
   };
 
+/* In-memory index of a directory's entries.
+
+   Built by reading the whole directory the first time it is
+   opened, and afterward kept up to date by dir_add() and
+   dir_remove(), so that looking up, adding, or removing a name
+   takes constant time instead of a scan of the directory.
+   Every struct dir open on the same directory shares one index.
+
+   Indexes outlive the struct dirs that use them, so that a
+   directory that is opened for every operation, as the root
+   is, is not read again each time.  At most INDEX_CACHE_CNT
+   unused indexes are kept, least recently used first to go. */
+struct dir_index
+  {
+    struct list_elem elem;              /* Element in index_list. */
+    block_sector_t sector;              /* Directory's inode sector. */
+    int open_cnt;                       /* Number of struct dirs. */
+    bool cached;                        /* In index_list? */
+    struct hash names;                  /* Entries in use, by name. */
+    struct list free_slots;             /* Free entries. */
+    off_t end;                          /* Offset just past the last entry. */
+  };
+
+/* A directory entry, as tracked by a dir_index.  An entry in
+   use is in its index's names, a free one in free_slots. */
+struct index_entry
+  {
+    struct hash_elem hash_elem;         /* Element in names. */
+    struct list_elem list_elem;         /* Element in free_slots. */
+    char name[NAME_MAX + 1];            /* Null terminated file name. */
+    block_sector_t inode_sector;        /* Sector number of header. */
+    off_t ofs;                          /* Offset in the directory. */
+  };
+
+/* Unused indexes to keep. */
+#define INDEX_CACHE_CNT 8
+
+/* Indexes, most recently used first.  Unlike the open inode
+   table, it has no lock of its own: every directory operation
+   runs under file_lock in userprog/syscall.c, which is what keeps
+   it consistent. */
+static struct list index_list;
+
+static struct dir_index *index_open (struct inode *);
+static void index_close (struct dir_index *);
+static void index_uncache (struct dir_index *);
+
+/* Initializes the directory module. */
+void
+dir_init (void) 
+{
+  list_init (&index_list);
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
-   given SECTOR.  Returns true if successful, false on failure. */
+   given SECTOR, with entries "." for itself and ".." for the
+   directory whose inode is in sector PARENT.  Returns true if
+   successful, false on failure. */
 bool
-dir_create (block_sector_t sector, size_t entry_cnt)
+dir_create (block_sector_t sector, size_t entry_cnt, block_sector_t parent)
 {
-  return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
+  struct dir *dir;
+  struct list_elem *e;
+  bool success;
+
+  /* Forget anything cached about a directory that used to be
+     here. */
+  dcache_invalidate_dir (sector);
+  for (e = list_begin (&index_list); e != list_end (&index_list);
+       e = list_next (e))
+    {
+      struct dir_index *index = list_entry (e, struct dir_index, elem);
+      if (index->sector == sector)
+        {
+          index_uncache (index);
+          break;
+        }
+    }
+
+  if (!inode_create (sector, entry_cnt * sizeof (struct dir_entry), true))
+    return false;
+  dir = dir_open (inode_open (sector));
+  success = (dir != NULL
+             && dir_add (dir, ".", sector)
+             && dir_add (dir, "..", parent));
+  dir_close (dir);
+  return success;
 }
 
 /* Opens and returns the directory for the given INODE, of which
@@ -35,7 +119,8 @@ struct dir *
 dir_open (struct inode *inode) 
 {
   struct dir *dir = calloc (1, sizeof *dir);
-  if (inode != NULL && dir != NULL)
+  if (inode != NULL && dir != NULL
+      && (dir->index = index_open (inode)) != NULL)
     {
       dir->inode = inode;
       dir->pos = 0;
@@ -71,6 +156,7 @@ dir_close (struct dir *dir)
 {
   if (dir != NULL)
     {
+      index_close (dir->index);
       inode_close (dir->inode);
       free (dir);
     }
@@ -83,32 +169,182 @@ dir_get_inode (struct dir *dir)
   return dir->inode;
 }
 
-/* Searches DIR for a file with the given NAME.
-   If successful, returns true, sets *EP to the directory entry
-   if EP is non-null, and sets *OFSP to the byte offset of the
-   directory entry if OFSP is non-null.
-   otherwise, returns false and ignores EP and OFSP. */
+/* Returns a hash value for index_entry E. */
+static unsigned
+index_entry_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_string (hash_entry (e, struct index_entry, hash_elem)->name);
+}
+
+/* Returns true if index_entry A's name precedes B's. */
 static bool
-lookup (const struct dir *dir, const char *name,
-        struct dir_entry *ep, off_t *ofsp) 
+index_entry_less (const struct hash_elem *a, const struct hash_elem *b,
+                  void *aux UNUSED)
+{
+  return strcmp (hash_entry (a, struct index_entry, hash_elem)->name,
+                 hash_entry (b, struct index_entry, hash_elem)->name) < 0;
+}
+
+/* Frees index_entry E. */
+static void
+index_entry_destroy (struct hash_elem *e, void *aux UNUSED)
+{
+  free (hash_entry (e, struct index_entry, hash_elem));
+}
+
+/* Frees INDEX and its entries. */
+static void
+index_destroy (struct dir_index *index) 
 {
+  while (!list_empty (&index->free_slots))
+    free (list_entry (list_pop_front (&index->free_slots),
+                      struct index_entry, list_elem));
+  hash_destroy (&index->names, index_entry_destroy);
+  free (index);
+}
+
+/* Frees the least recently used unused indexes, until no more
+   than INDEX_CACHE_CNT unused ones remain. */
+static void
+index_trim (void) 
+{
+  struct list_elem *e;
+  size_t unused_cnt = 0;
+
+  for (e = list_begin (&index_list); e != list_end (&index_list); )
+    {
+      struct dir_index *index = list_entry (e, struct dir_index, elem);
+      e = list_next (e);
+      if (index->open_cnt == 0 && ++unused_cnt > INDEX_CACHE_CNT)
+        {
+          list_remove (&index->elem);
+          index_destroy (index);
+        }
+    }
+}
+
+/* Reads directory INODE into a new index.  Returns the index,
+   or a null pointer if memory ran out. */
+static struct dir_index *
+index_build (struct inode *inode) 
+{
+  struct dir_index *index;
   struct dir_entry e;
-  size_t ofs;
-  
-  ASSERT (dir != NULL);
-  ASSERT (name != NULL);
+  off_t ofs;
+
+  index = malloc (sizeof *index);
+  if (index == NULL)
+    return NULL;
+  index->sector = inode_get_inumber (inode);
+  index->open_cnt = 0;
+  index->cached = false;
+  list_init (&index->free_slots);
+  if (!hash_init (&index->names, index_entry_hash, index_entry_less, NULL))
+    {
+      free (index);
+      return NULL;
+    }
+
+  for (ofs = 0; inode_read_at (inode, &e, sizeof e, ofs) == sizeof e;
+       ofs += sizeof e)
+    {
+      struct index_entry *ie = malloc (sizeof *ie);
+      if (ie == NULL)
+        {
+          index_destroy (index);
+          return NULL;
+        }
+      ie->ofs = ofs;
+      if (e.in_use)
+        {
+          strlcpy (ie->name, e.name, sizeof ie->name);
+          ie->inode_sector = e.inode_sector;
+          hash_insert (&index->names, &ie->hash_elem);
+        }
+      else
+        list_push_back (&index->free_slots, &ie->list_elem);
+    }
+  index->end = ofs;
+  return index;
+}
+
+/* Returns the index of directory INODE, building it if it is
+   not cached.  Returns a null pointer if memory ran out.  The
+   caller must index_close() the index. */
+static struct dir_index *
+index_open (struct inode *inode) 
+{
+  block_sector_t sector = inode_get_inumber (inode);
+  struct dir_index *index = NULL;
+  struct list_elem *e;
 
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (e.in_use && !strcmp (name, e.name)) 
+  for (e = list_begin (&index_list); e != list_end (&index_list);
+       e = list_next (e))
+    if (list_entry (e, struct dir_index, elem)->sector == sector)
       {
-        if (ep != NULL)
-          *ep = e;
-        if (ofsp != NULL)
-          *ofsp = ofs;
-        return true;
+        index = list_entry (e, struct dir_index, elem);
+        list_remove (&index->elem);
+        break;
       }
-  return false;
+  if (index == NULL)
+    {
+      index = index_build (inode);
+      if (index == NULL)
+        return NULL;
+      index->cached = true;
+    }
+
+  list_push_front (&index_list, &index->elem);
+  index->open_cnt++;
+  index_trim ();
+  return index;
+}
+
+/* Stops using INDEX, keeping it for later if it is still
+   cached. */
+static void
+index_close (struct dir_index *index) 
+{
+  ASSERT (index->open_cnt > 0);
+
+  index->open_cnt--;
+  if (!index->cached)
+    {
+      if (index->open_cnt == 0)
+        index_destroy (index);
+    }
+  else
+    index_trim ();
+}
+
+/* Removes INDEX from the cache, so that the next dir_open() of
+   its sector builds a new one.  INDEX is freed once no struct
+   dir uses it. */
+static void
+index_uncache (struct dir_index *index) 
+{
+  list_remove (&index->elem);
+  index->cached = false;
+  if (index->open_cnt == 0)
+    index_destroy (index);
+}
+
+/* Searches DIR for a file with the given NAME.  Returns its
+   index entry, or a null pointer if there is none. */
+static struct index_entry *
+lookup (const struct dir *dir, const char *name) 
+{
+  struct index_entry key;
+  struct hash_elem *e;
+
+  ASSERT (dir != NULL);
+  ASSERT (name != NULL);
+
+  if (strlen (name) > NAME_MAX)
+    return NULL;
+  strlcpy (key.name, name, sizeof key.name);
+  e = hash_find (&dir->index->names, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct index_entry, hash_elem) : NULL;
 }
 
 /* Searches DIR for a file with the given NAME
@@ -119,15 +355,25 @@ bool
 dir_lookup (const struct dir *dir, const char *name,
             struct inode **inode) 
 {
-  struct dir_entry e;
+  block_sector_t dir_sector, sector;
+  struct index_entry *ie;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  if (lookup (dir, name, &e, NULL))
-    *inode = inode_open (e.inode_sector);
+  dir_sector = inode_get_inumber (dir->inode);
+  if (dcache_lookup (dir_sector, name, &sector, NULL))
+    *inode = sector != 0 ? inode_open (sector) : NULL;
   else
-    *inode = NULL;
+    {
+      ie = lookup (dir, name);
+      *inode = ie != NULL ? inode_open (ie->inode_sector) : NULL;
+      if (ie == NULL)
+        dcache_insert (dir_sector, name, 0, false);
+      else if (*inode != NULL)
+        dcache_insert (dir_sector, name, ie->inode_sector,
+                       inode_is_dir (*inode));
+    }
 
   return *inode != NULL;
 }
@@ -141,8 +387,9 @@ dir_lookup (const struct dir *dir, const char *name,
 bool
 dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
 {
+  struct dir_index *index;
+  struct index_entry *ie;
   struct dir_entry e;
-  off_t ofs;
   bool success = false;
 
   ASSERT (dir != NULL);
@@ -153,58 +400,100 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
     return false;
 
   /* Check that NAME is not in use. */
-  if (lookup (dir, name, NULL, NULL))
+  if (lookup (dir, name) != NULL)
     goto done;
 
-  /* Set OFS to offset of free slot.
-     If there are no free slots, then it will be set to the
-     current end-of-file.
-     
-     inode_read_at() will only return a short read at end of file.
-     Otherwise, we'd need to verify that we didn't get a short
-     read due to something intermittent such as low memory. */
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (!e.in_use)
-      break;
+  /* Take a free slot.
+     If there are no free slots, append one at end-of-file. */
+  index = dir->index;
+  if (!list_empty (&index->free_slots))
+    ie = list_entry (list_pop_front (&index->free_slots),
+                     struct index_entry, list_elem);
+  else
+    {
+      ie = malloc (sizeof *ie);
+      if (ie == NULL)
+        goto done;
+      ie->ofs = index->end;
+    }
 
   /* Write slot. */
   e.in_use = true;
   strlcpy (e.name, name, sizeof e.name);
   e.inode_sector = inode_sector;
-  success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+  success = inode_write_at (dir->inode, &e, sizeof e, ie->ofs) == sizeof e;
+
+  /* Record it in the index. */
+  if (success)
+    {
+      strlcpy (ie->name, name, sizeof ie->name);
+      ie->inode_sector = inode_sector;
+      hash_insert (&index->names, &ie->hash_elem);
+      if (ie->ofs == index->end)
+        index->end += sizeof e;
+      dcache_invalidate (inode_get_inumber (dir->inode), name);
+    }
+  else if (ie->ofs < index->end)
+    list_push_front (&index->free_slots, &ie->list_elem);
+  else
+    free (ie);
 
  done:
   return success;
 }
 
+/* Returns true if directory INODE has no entries besides "."
+   and "..". */
+static bool
+is_empty (struct inode *inode) 
+{
+  struct dir_index *index = index_open (inode);
+  bool empty = index != NULL && hash_size (&index->names) <= 2;
+
+  if (index != NULL)
+    index_close (index);
+  return empty;
+}
+
 /* Removes any entry for NAME in DIR.
    Returns true if successful, false on failure,
-   which occurs only if there is no file with the given NAME. */
+   which occurs if there is no file with the given NAME, if NAME
+   is "." or "..", or if NAME is a directory that is not
+   empty. */
 bool
 dir_remove (struct dir *dir, const char *name) 
 {
+  struct index_entry *ie;
   struct dir_entry e;
   struct inode *inode = NULL;
   bool success = false;
-  off_t ofs;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
   /* Find directory entry. */
-  if (!lookup (dir, name, &e, &ofs))
+  if (!strcmp (name, ".") || !strcmp (name, ".."))
+    goto done;
+  ie = lookup (dir, name);
+  if (ie == NULL)
     goto done;
 
-  /* Open inode. */
-  inode = inode_open (e.inode_sector);
-  if (inode == NULL)
+  /* Open inode.  A directory must be empty. */
+  inode = inode_open (ie->inode_sector);
+  if (inode == NULL || (inode_is_dir (inode) && !is_empty (inode)))
     goto done;
 
   /* Erase directory entry. */
+  e.inode_sector = ie->inode_sector;
+  strlcpy (e.name, ie->name, sizeof e.name);
   e.in_use = false;
-  if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e) 
+  if (inode_write_at (dir->inode, &e, sizeof e, ie->ofs) != sizeof e) 
     goto done;
+  hash_delete (&dir->index->names, &ie->hash_elem);
+  list_push_front (&dir->index->free_slots, &ie->list_elem);
+  dcache_invalidate (inode_get_inumber (dir->inode), name);
+  if (inode_is_dir (inode))
+    dcache_invalidate_dir (inode_get_inumber (inode));
 
   /* Remove inode. */
   inode_remove (inode);
@@ -220,13 +509,24 @@ dir_remove (struct dir *dir, const char *name)
    contains no more entries. */
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
+{
+  return dir_readdir_at (dir->inode, &dir->pos, name);
+}
+
+/* Reads the entry of directory INODE at byte offset *POS, or
+   the next one in use after it, and stores its name in NAME,
+   skipping "." and "..".  Advances *POS past the entry.
+   Returns true if successful, false if the directory contains
+   no more entries. */
+bool
+dir_readdir_at (struct inode *inode, off_t *pos, char name[NAME_MAX + 1])
 {
   struct dir_entry e;
 
-  while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) 
+  while (inode_read_at (inode, &e, sizeof e, *pos) == sizeof e) 
     {
-      dir->pos += sizeof e;
-      if (e.in_use)
+      *pos += sizeof e;
+      if (e.in_use && strcmp (e.name, ".") && strcmp (e.name, ".."))
         {
           strlcpy (name, e.name, NAME_MAX + 1);
           return true;
@@ -1,8 +1,15 @@
 #include "filesys/file.h"
 #include <debug.h>
+#include "devices/block.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
 
+/* Read-ahead window sizes, in sectors. */
+#define READAHEAD_MIN 2
+#define READAHEAD_MAX 16
+
+static void readahead(struct file *, off_t ofs, off_t size);
+
 /* Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
    allocation fails or if INODE is null. */
@@ -59,6 +66,7 @@ file_get_inode(struct file *file)
 off_t file_read(struct file *file, void *buffer, off_t size)
 {
   off_t bytes_read = inode_read_at(file->inode, buffer, size, file->pos);
+  readahead(file, file->pos, bytes_read);
   file->pos += bytes_read;
   return bytes_read;
 }
@@ -70,7 +78,42 @@ off_t file_read(struct file *file, void *buffer, off_t size)
    The file's current position is unaffected. */
 off_t file_read_at(struct file *file, void *buffer, off_t size, off_t file_ofs)
 {
-  return inode_read_at(file->inode, buffer, size, file_ofs);
+  off_t bytes_read = inode_read_at(file->inode, buffer, size, file_ofs);
+  readahead(file, file_ofs, bytes_read);
+  return bytes_read;
+}
+
+/* Notes that SIZE bytes were just read from FILE at offset OFS.
+   A read that continues where the previous one ended grows
+   FILE's read-ahead window, starting at READAHEAD_MIN sectors
+   and doubling up to READAHEAD_MAX, and any other read closes
+   it.  Then queues read-ahead of the part of the window past the
+   data already read ahead. */
+static void
+readahead(struct file *file, off_t ofs, off_t size)
+{
+  off_t start, end;
+
+  if (ofs != file->ra_pos || size == 0)
+  {
+    file->ra_window = 0;
+    file->ra_end = 0;
+  }
+  else if (file->ra_window == 0)
+    file->ra_window = READAHEAD_MIN;
+  else if (file->ra_window < READAHEAD_MAX)
+    file->ra_window *= 2;
+  file->ra_pos = ofs + size;
+
+  if (file->ra_window == 0)
+    return;
+  start = file->ra_pos > file->ra_end ? file->ra_pos : file->ra_end;
+  end = file->ra_pos + file->ra_window * BLOCK_SECTOR_SIZE;
+  if (start < end)
+  {
+    inode_readahead(file->inode, start, end - start);
+    file->ra_end = end;
+  }
 }
 
 /* Writes SIZE bytes from BUFFER into FILE,
@@ -14,6 +14,9 @@ struct file
     struct inode *inode; /* File's inode. */
     off_t pos;           /* Current position. */
     bool deny_write;     /* Has file_deny_write() been called? */
+    off_t ra_pos;        /* Where the next sequential read starts. */
+    off_t ra_end;        /* End of the data read ahead so far. */
+    int ra_window;       /* Read-ahead window in sectors, 0 if none. */
 };
 
 /* Opening and closing files. */
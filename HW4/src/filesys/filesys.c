@@ -2,15 +2,20 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/cache.h"
+#include "filesys/dcache.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "threads/thread.h"
 
 /* Partition that contains the file system. */
 struct block *fs_device;
 
 static void do_format (void);
+static struct dir *resolve (const char *path, char name[NAME_MAX + 1]);
+static bool create (const char *name, off_t initial_size, bool is_dir);
 
 /* Initializes the file system module.
    If FORMAT is true, reformats the file system. */
@@ -21,7 +26,10 @@ filesys_init (bool format)
   if (fs_device == NULL)
     PANIC ("No file system device found, can't initialize file system.");
 
+  cache_init ();
   inode_init ();
+  dcache_init ();
+  dir_init ();
   free_map_init ();
 
   if (format) 
@@ -36,6 +44,7 @@ void
 filesys_done (void) 
 {
   free_map_close ();
+  cache_flush ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -45,12 +54,38 @@ filesys_done (void)
 bool
 filesys_create (const char *name, off_t initial_size) 
 {
+  return create (name, initial_size, false);
+}
+
+/* Creates an empty directory named NAME.
+   Returns true if successful, false otherwise.
+   Fails if a file named NAME already exists,
+   or if internal memory allocation fails. */
+bool
+filesys_mkdir (const char *name) 
+{
+  return create (name, 0, true);
+}
+
+/* Creates a file or, if IS_DIR is true, a directory named
+   NAME, with the given INITIAL_SIZE. */
+static bool
+create (const char *name, off_t initial_size, bool is_dir) 
+{
+  char base[NAME_MAX + 1];
   block_sector_t inode_sector = 0;
-  struct dir *dir = dir_open_root ();
-  bool success = (dir != NULL
-                  && free_map_allocate (1, &inode_sector)
-                  && inode_create (inode_sector, initial_size)
-                  && dir_add (dir, name, inode_sector));
+  struct dir *dir = resolve (name, base);
+  block_sector_t near;
+  bool success;
+
+  /* Keep the inodes of a directory's files close to it. */
+  near = dir != NULL ? inode_get_inumber (dir_get_inode (dir)) : 0;
+  success = (dir != NULL
+             && free_map_allocate_near (near, 1, &inode_sector)
+             && (is_dir
+                 ? dir_create (inode_sector, 0, near)
+                 : inode_create (inode_sector, initial_size, false))
+             && dir_add (dir, base, inode_sector));
   if (!success && inode_sector != 0) 
     free_map_release (inode_sector, 1);
   dir_close (dir);
@@ -58,7 +93,7 @@ filesys_create (const char *name, off_t initial_size)
   return success;
 }
 
-/* Opens the file with the given NAME.
+/* Opens the file or directory with the given NAME.
    Returns the new file if successful or a null pointer
    otherwise.
    Fails if no file named NAME exists,
@@ -66,29 +101,147 @@ filesys_create (const char *name, off_t initial_size)
 struct file *
 filesys_open (const char *name)
 {
-  struct dir *dir = dir_open_root ();
+  char base[NAME_MAX + 1];
+  struct dir *dir = resolve (name, base);
   struct inode *inode = NULL;
 
   if (dir != NULL)
-    dir_lookup (dir, name, &inode);
+    dir_lookup (dir, base, &inode);
   dir_close (dir);
 
   return file_open (inode);
 }
 
-/* Deletes the file named NAME.
+/* Deletes the file or empty directory named NAME.
    Returns true if successful, false on failure.
    Fails if no file named NAME exists,
    or if an internal memory allocation fails. */
 bool
 filesys_remove (const char *name) 
 {
-  struct dir *dir = dir_open_root ();
-  bool success = dir != NULL && dir_remove (dir, name);
+  char base[NAME_MAX + 1];
+  struct dir *dir = resolve (name, base);
+  bool success = dir != NULL && dir_remove (dir, base);
   dir_close (dir); 
 
   return success;
 }
+
+/* Makes the directory named NAME the running thread's working
+   directory.
+   Returns true if successful, false on failure.
+   Fails if no directory named NAME exists,
+   or if an internal memory allocation fails. */
+bool
+filesys_chdir (const char *name) 
+{
+  char base[NAME_MAX + 1];
+  struct dir *dir = resolve (name, base);
+  struct inode *inode = NULL;
+  struct thread *t = thread_current ();
+
+  if (dir != NULL)
+    dir_lookup (dir, base, &inode);
+  dir_close (dir);
+
+  if (inode == NULL || !inode_is_dir (inode))
+    {
+      inode_close (inode);
+      return false;
+    }
+  dir = dir_open (inode);
+  if (dir == NULL)
+    return false;
+  dir_close (t->cwd);
+  t->cwd = dir;
+  return true;
+}
+
+/* Sets *SECTOR, a directory's inode sector, to the sector of
+   the inode that NAME in that directory refers to.
+   Returns true if successful, false if there is no such entry
+   or it is not a directory.
+
+   Consults the dentry cache first, so that a path whose
+   directories were all looked up recently resolves without
+   opening them. */
+static bool
+walk (block_sector_t *sector, const char *name) 
+{
+  block_sector_t child;
+  bool is_dir;
+
+  if (!dcache_lookup (*sector, name, &child, &is_dir))
+    {
+      struct dir *dir = dir_open (inode_open (*sector));
+      struct inode *inode = NULL;
+
+      if (dir == NULL)
+        return false;
+      dir_lookup (dir, name, &inode);
+      child = inode != NULL ? inode_get_inumber (inode) : 0;
+      is_dir = inode != NULL && inode_is_dir (inode);
+      inode_close (inode);
+      dir_close (dir);
+    }
+
+  if (child == 0 || !is_dir)
+    return false;
+  *sector = child;
+  return true;
+}
+
+/* Resolves PATH, which is relative to the running thread's
+   working directory unless it begins with `/', up to its last
+   component, which is copied into NAME.  A PATH that ends in
+   `/' after its last component names that component; "/" alone
+   names the root directory by its "." entry.
+   Returns the directory that should contain NAME, which the
+   caller must close, or a null pointer if PATH is empty or too
+   long, if a directory along it does not exist, or if the
+   working directory has been removed. */
+static struct dir *
+resolve (const char *path, char name[NAME_MAX + 1]) 
+{
+  struct dir *cwd = thread_current ()->cwd;
+  block_sector_t sector = ROOT_DIR_SECTOR;
+
+  if (*path == '\0')
+    return NULL;
+  if (*path != '/' && cwd != NULL)
+    {
+      if (inode_is_removed (dir_get_inode (cwd)))
+        return NULL;
+      sector = inode_get_inumber (dir_get_inode (cwd));
+    }
+
+  strlcpy (name, ".", NAME_MAX + 1);
+  for (;;)
+    {
+      size_t len;
+
+      while (*path == '/')
+        path++;
+      if (*path == '\0')
+        break;
+
+      len = strcspn (path, "/");
+      if (len > NAME_MAX)
+        return NULL;
+      memcpy (name, path, len);
+      name[len] = '\0';
+      path += len;
+
+      while (*path == '/')
+        path++;
+      if (*path == '\0')
+        break;
+      if (!walk (&sector, name))
+        return NULL;
+    }
+
+  return dir_open (inode_open (sector));
+}
 
 /* Formats the file system. */
 static void
@@ -96,7 +249,7 @@ do_format (void)
 {
   printf ("Formatting file system...");
   free_map_create ();
-  if (!dir_create (ROOT_DIR_SECTOR, 16))
+  if (!dir_create (ROOT_DIR_SECTOR, 16, ROOT_DIR_SECTOR))
     PANIC ("root directory creation failed");
   free_map_close ();
   printf ("done.\n");
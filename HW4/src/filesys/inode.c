@@ -1,76 +1,221 @@
 #include "filesys/inode.h"
+#include <hash.h>
 #include <list.h>
 #include <debug.h>
 #include <round.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Number of data sectors that the inode itself points to. */
+#define DIRECT_CNT 123
+
+/* Number of sector numbers in an index block. */
+#define PTRS_PER_SECTOR (BLOCK_SECTOR_SIZE / sizeof (block_sector_t))
+
 /* On-disk inode.
-   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+   Must be exactly BLOCK_SECTOR_SIZE bytes long.
+
+   The first DIRECT_CNT data sectors are listed in the inode
+   itself, the next PTRS_PER_SECTOR in the index block
+   `indirect', and the rest in the index blocks listed in the
+   index block `doubly_indirect'.  Sectors are allocated only when
+   first written, so sector number 0, which always belongs to the
+   free map, stands for a hole that reads as zeros. */
 struct inode_disk
   {
-    block_sector_t start;               /* First data sector. */
+    block_sector_t direct[DIRECT_CNT];  /* Data sectors. */
+    block_sector_t indirect;            /* Index block of data sectors. */
+    block_sector_t doubly_indirect;     /* Index block of index blocks. */
     off_t length;                       /* File size in bytes. */
+    uint32_t is_dir;                    /* 1 if a directory, else 0. */
     unsigned magic;                     /* Magic number. */
-    uint32_t unused[125];               /* Not used. */
   };
 
-/* Returns the number of sectors to allocate for an inode SIZE
-   bytes long. */
-static inline size_t
-bytes_to_sectors (off_t size)
-{
-  return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
-}
-
 /* In-memory inode. */
 struct inode 
   {
-    struct list_elem elem;              /* Element in inode list. */
+    struct hash_elem elem;              /* Element in open_inodes. */
     block_sector_t sector;              /* Sector number of disk location. */
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    struct rwlock rwlock;               /* Readers share, writers exclude. */
+    block_sector_t next_sector;         /* Where to allocate next. */
     struct inode_disk data;             /* Inode content. */
   };
 
+/* Allocates a sector for INODE and fills it with zeros.
+   Returns the sector, or 0 if the disk is full.
+
+   Each allocation starts looking where the previous one for
+   INODE left off, so that a file that grows sequentially gets
+   sequential sectors, right after its inode if it was created
+   on a fresh disk. */
+static block_sector_t
+allocate_zeroed (struct inode *inode)
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
+  block_sector_t sector;
+
+  if (!free_map_allocate_near (inode->next_sector, 1, &sector))
+    return 0;
+  inode->next_sector = sector + 1;
+  cache_write (sector, zeros, 0, BLOCK_SECTOR_SIZE);
+  return sector;
+}
+
+/* Returns the sector that *SLOT, a member of INODE's in-memory
+   inode_disk, points to.  If there is none and CREATE is true,
+   allocates one first, writing INODE back to disk.  Returns 0
+   if there is no sector. */
+static block_sector_t
+slot_lookup (struct inode *inode, block_sector_t *slot, bool create)
+{
+  if (*slot == 0 && create && (*slot = allocate_zeroed (inode)) != 0)
+    cache_write (inode->sector, &inode->data, 0, BLOCK_SECTOR_SIZE);
+  return *slot;
+}
+
+/* Returns the sector that entry IDX of INODE's index block INDEX
+   points to.  If there is none and CREATE is true, allocates one
+   first.  Returns 0 if there is no sector. */
+static block_sector_t
+index_lookup (struct inode *inode, block_sector_t index, size_t idx,
+              bool create)
+{
+  block_sector_t sector;
+
+  cache_read (index, &sector, idx * sizeof sector, sizeof sector);
+  if (sector == 0 && create && (sector = allocate_zeroed (inode)) != 0)
+    cache_write (index, &sector, idx * sizeof sector, sizeof sector);
+  return sector;
+}
+
 /* Returns the block device sector that contains byte offset POS
-   within INODE.
-   Returns -1 if INODE does not contain data for a byte at offset
-   POS. */
+   within INODE.  If no sector has been allocated for POS yet and
+   CREATE is true, allocates it and any index blocks needed to
+   reach it.
+   Returns 0 if INODE has no sector for POS, either because POS
+   lies in a hole or past the largest possible file, or because
+   allocation failed. */
 static block_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) 
+byte_to_sector (struct inode *inode, off_t pos, bool create)
 {
+  size_t idx = pos / BLOCK_SECTOR_SIZE;
+  block_sector_t index;
+
   ASSERT (inode != NULL);
-  if (pos < inode->data.length)
-    return inode->data.start + pos / BLOCK_SECTOR_SIZE;
-  else
-    return -1;
+  ASSERT (pos >= 0);
+
+  if (idx < DIRECT_CNT)
+    return slot_lookup (inode, &inode->data.direct[idx], create);
+  idx -= DIRECT_CNT;
+
+  if (idx < PTRS_PER_SECTOR)
+    {
+      index = slot_lookup (inode, &inode->data.indirect, create);
+      return index != 0 ? index_lookup (inode, index, idx, create) : 0;
+    }
+  idx -= PTRS_PER_SECTOR;
+
+  if (idx < PTRS_PER_SECTOR * PTRS_PER_SECTOR)
+    {
+      index = slot_lookup (inode, &inode->data.doubly_indirect, create);
+      if (index != 0)
+        index = index_lookup (inode, index, idx / PTRS_PER_SECTOR, create);
+      return index != 0 ? index_lookup (inode, index, idx % PTRS_PER_SECTOR,
+                                        create) : 0;
+    }
+  return 0;
+}
+
+/* Releases index block INDEX and every sector it points to.  If
+   DEPTH is greater than 1, those are index blocks themselves, to
+   be released with DEPTH - 1. */
+static void
+release_index (block_sector_t index, int depth)
+{
+  size_t i;
+
+  for (i = 0; i < PTRS_PER_SECTOR; i++)
+    {
+      block_sector_t sector;
+
+      cache_read (index, &sector, i * sizeof sector, sizeof sector);
+      if (sector != 0 && depth > 1)
+        release_index (sector, depth - 1);
+      else if (sector != 0)
+        free_map_release (sector, 1);
+    }
+  free_map_release (index, 1);
+}
+
+/* Releases all the data sectors and index blocks of INODE. */
+static void
+release_sectors (struct inode *inode)
+{
+  size_t i;
+
+  for (i = 0; i < DIRECT_CNT; i++)
+    if (inode->data.direct[i] != 0)
+      free_map_release (inode->data.direct[i], 1);
+  if (inode->data.indirect != 0)
+    release_index (inode->data.indirect, 1);
+  if (inode->data.doubly_indirect != 0)
+    release_index (inode->data.doubly_indirect, 2);
 }
 
-/* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
-static struct list open_inodes;
+/* Open inodes, by sector, so that opening a single inode twice
+   returns the same `struct inode'.  open_inodes_lock protects
+   the table and every open inode's open_cnt. */
+static struct hash open_inodes;
+static struct lock open_inodes_lock;
+
+static hash_hash_func inode_hash;
+static hash_less_func inode_less;
 
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
-  list_init (&open_inodes);
+  if (!hash_init (&open_inodes, inode_hash, inode_less, NULL))
+    PANIC ("couldn't allocate open inode table");
+  lock_init (&open_inodes_lock);
+  lock_register (&open_inodes_lock, "open_inodes_lock");
+}
+
+/* Returns a hash value for inode E. */
+static unsigned
+inode_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct inode, elem)->sector);
+}
+
+/* Returns true if inode A's sector precedes inode B's. */
+static bool
+inode_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct inode, elem)->sector
+          < hash_entry (b, struct inode, elem)->sector);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
-   device.
+   device, marking it as a directory if IS_DIR is true.  The
+   data starts out as a hole that reads as zeros;
+   its sectors are only allocated as they are written.
    Returns true if successful.
-   Returns false if memory or disk allocation fails. */
+   Returns false if memory allocation fails. */
 bool
-inode_create (block_sector_t sector, off_t length)
+inode_create (block_sector_t sector, off_t length, bool is_dir)
 {
   struct inode_disk *disk_inode = NULL;
   bool success = false;
@@ -84,22 +229,11 @@ inode_create (block_sector_t sector, off_t length)
   disk_inode = calloc (1, sizeof *disk_inode);
   if (disk_inode != NULL)
     {
-      size_t sectors = bytes_to_sectors (length);
       disk_inode->length = length;
+      disk_inode->is_dir = is_dir;
       disk_inode->magic = INODE_MAGIC;
-      if (free_map_allocate (sectors, &disk_inode->start)) 
-        {
-          block_write (fs_device, sector, disk_inode);
-          if (sectors > 0) 
-            {
-              static char zeros[BLOCK_SECTOR_SIZE];
-              size_t i;
-              
-              for (i = 0; i < sectors; i++) 
-                block_write (fs_device, disk_inode->start + i, zeros);
-            }
-          success = true; 
-        } 
+      cache_write (sector, disk_inode, 0, BLOCK_SECTOR_SIZE);
+      success = true; 
       free (disk_inode);
     }
   return success;
@@ -111,33 +245,41 @@ inode_create (block_sector_t sector, off_t length)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
+  struct inode key;
+  struct hash_elem *e;
   struct inode *inode;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
+  key.sector = sector;
+  lock_acquire (&open_inodes_lock);
+  e = hash_find (&open_inodes, &key.elem);
+  if (e != NULL)
     {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          inode_reopen (inode);
-          return inode; 
-        }
+      inode = hash_entry (e, struct inode, elem);
+      inode->open_cnt++;
+      lock_release (&open_inodes_lock);
+      return inode;
     }
 
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
   if (inode == NULL)
-    return NULL;
+    {
+      lock_release (&open_inodes_lock);
+      return NULL;
+    }
 
-  /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
+  /* Initialize.  Keep the lock until the inode is read in, so
+     that nobody else opening it finds it half initialized. */
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  block_read (fs_device, inode->sector, &inode->data);
+  rwlock_init (&inode->rwlock);
+  inode->next_sector = sector + 1;
+  cache_read (inode->sector, &inode->data, 0, BLOCK_SECTOR_SIZE);
+  hash_insert (&open_inodes, &inode->elem);
+  lock_release (&open_inodes_lock);
   return inode;
 }
 
@@ -146,7 +288,11 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      lock_acquire (&open_inodes_lock);
+      inode->open_cnt++;
+      lock_release (&open_inodes_lock);
+    }
   return inode;
 }
 
@@ -168,21 +314,25 @@ inode_close (struct inode *inode)
     return;
 
   /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  lock_acquire (&open_inodes_lock);
+  if (--inode->open_cnt > 0)
+    {
+      lock_release (&open_inodes_lock);
+      return;
+    }
+
+  /* Remove from inode table and release lock. */
+  hash_delete (&open_inodes, &inode->elem);
+  lock_release (&open_inodes_lock);
+
+  /* Deallocate blocks if removed. */
+  if (inode->removed) 
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
- 
-      /* Deallocate blocks if removed. */
-      if (inode->removed) 
-        {
-          free_map_release (inode->sector, 1);
-          free_map_release (inode->data.start,
-                            bytes_to_sectors (inode->data.length)); 
-        }
-
-      free (inode); 
+      free_map_release (inode->sector, 1);
+      release_sectors (inode);
     }
+
+  free (inode); 
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -202,12 +352,11 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
-  uint8_t *bounce = NULL;
 
   while (size > 0) 
     {
       /* Disk sector to read, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      block_sector_t sector_idx = byte_to_sector (inode, offset, false);
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -220,47 +369,50 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
-        }
-      else 
-        {
-          /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-          block_read (fs_device, sector_idx, bounce);
-          memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
-        }
+      if (sector_idx != 0)
+        cache_read (sector_idx, buffer + bytes_read, sector_ofs, chunk_size);
+      else
+        memset (buffer + bytes_read, 0, chunk_size);
       
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_read += chunk_size;
     }
-  free (bounce);
 
   return bytes_read;
 }
 
-/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
+/* Queues the sectors that hold the SIZE bytes of INODE starting
+   at OFFSET to be read into the buffer cache in the background,
+   stopping at end of file. */
+void
+inode_readahead (struct inode *inode, off_t offset, off_t size)
+{
+  off_t end = offset + size;
+
+  if (end > inode_length (inode))
+    end = inode_length (inode);
+  for (offset = ROUND_DOWN (offset, BLOCK_SECTOR_SIZE); offset < end;
+       offset += BLOCK_SECTOR_SIZE)
+    {
+      block_sector_t sector = byte_to_sector (inode, offset, false);
+      if (sector != 0)
+        cache_readahead (sector);
+    }
+}
+
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET,
+   extending INODE if the write ends past end of file.
    Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   less than SIZE if the disk fills up, if the write would
+   exceed the largest possible file, or if an error occurs. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
                 off_t offset) 
 {
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
 
   if (inode->deny_write_cnt)
     return 0;
@@ -268,55 +420,51 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   while (size > 0) 
     {
       /* Sector to write, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      block_sector_t sector_idx = byte_to_sector (inode, offset, true);
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
-      int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
-      int min_left = inode_left < sector_left ? inode_left : sector_left;
-
       /* Number of bytes to actually write into this sector. */
-      int chunk_size = size < min_left ? size : min_left;
-      if (chunk_size <= 0)
+      int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
+      int chunk_size = size < sector_left ? size : sector_left;
+      if (sector_idx == 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
-        }
-      else 
-        {
-          /* We need a bounce buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-
-          /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left) 
-            block_read (fs_device, sector_idx, bounce);
-          else
-            memset (bounce, 0, BLOCK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          block_write (fs_device, sector_idx, bounce);
-        }
+      cache_write (sector_idx, buffer + bytes_written, sector_ofs,
+                   chunk_size);
 
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_written += chunk_size;
     }
-  free (bounce);
+
+  /* Extend the file only now, so that readers never see
+     unwritten data past the old end of file. */
+  if (offset > inode->data.length)
+    {
+      inode->data.length = offset;
+      cache_write (inode->sector, &inode->data, 0, BLOCK_SECTOR_SIZE);
+    }
 
   return bytes_written;
 }
 
+/* Allocates every sector, including index blocks, that INODE
+   needs to hold its first SIZE bytes, so that later writes
+   within them fill in no holes and leave INODE's index alone.
+   Returns false if the disk fills up first.
+   The caller must hold INODE's write lock. */
+bool
+inode_reserve (struct inode *inode, off_t size)
+{
+  off_t pos;
+
+  for (pos = 0; pos < size; pos += BLOCK_SECTOR_SIZE)
+    if (byte_to_sector (inode, pos, true) == 0)
+      return false;
+  return true;
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void
@@ -337,9 +485,54 @@ inode_allow_write (struct inode *inode)
   inode->deny_write_cnt--;
 }
 
+/* Returns true if INODE is a directory. */
+bool
+inode_is_dir (const struct inode *inode)
+{
+  return inode->data.is_dir != 0;
+}
+
+/* Returns true if INODE has been removed. */
+bool
+inode_is_removed (const struct inode *inode)
+{
+  return inode->removed;
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode)
 {
   return inode->data.length;
 }
+
+/* Acquires INODE's data lock for reading.  Any number of
+   threads may read INODE concurrently, but not while it is
+   being written. */
+void
+inode_lock_read (struct inode *inode)
+{
+  rwlock_acquire_read (&inode->rwlock);
+}
+
+/* Releases INODE's data lock, held for reading. */
+void
+inode_unlock_read (struct inode *inode)
+{
+  rwlock_release_read (&inode->rwlock);
+}
+
+/* Acquires INODE's data lock for writing, excluding all other
+   readers and writers of INODE. */
+void
+inode_lock_write (struct inode *inode)
+{
+  rwlock_acquire_write (&inode->rwlock);
+}
+
+/* Releases INODE's data lock, held for writing. */
+void
+inode_unlock_write (struct inode *inode)
+{
+  rwlock_release_write (&inode->rwlock);
+}
@@ -64,6 +64,7 @@ void
 console_init (void) 
 {
   lock_init (&console_lock);
+  lock_register (&console_lock, "console_lock");
   use_console_lock = true;
 }
 
@@ -0,0 +1,17 @@
+#ifndef __LIB_LOCKSTAT_H
+#define __LIB_LOCKSTAT_H
+
+/* Contention statistics for one kernel lock, as returned by the
+   lockstat() system call.  Times are in timer ticks. */
+struct lockstat
+  {
+    char name[16];              /* Name the lock was registered under. */
+    unsigned acquire_cnt;       /* # of times the lock was acquired. */
+    unsigned contended_cnt;     /* # of those that had to wait. */
+    long long wait_ticks;       /* Total time spent waiting. */
+    long long max_wait_ticks;   /* Longest single wait. */
+    long long hold_ticks;       /* Total time the lock was held. */
+    long long max_hold_ticks;   /* Longest single hold. */
+  };
+
+#endif /* lib/lockstat.h */
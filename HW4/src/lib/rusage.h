@@ -0,0 +1,26 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+/* Values for the WHO argument of the getrusage() system call. */
+#define RUSAGE_SELF 0           /* The calling process. */
+#define RUSAGE_CHILDREN (-1)    /* Its children that have been waited for. */
+
+/* Resource usage of a process, as returned by the getrusage()
+   system call.  Times are in timer ticks.  Block I/O counts the
+   sectors that the process missed in the buffer cache or
+   dirtied there, and the sectors it moved to and from swap,
+   whichever thread actually did the disk I/O. */
+struct rusage
+  {
+    long long user_ticks;       /* Ticks spent running in user mode. */
+    long long kernel_ticks;     /* Ticks spent running in the kernel. */
+    unsigned voluntary_switches;   /* # of times it blocked or yielded. */
+    unsigned involuntary_switches; /* # of times it was preempted. */
+    unsigned file_faults;       /* Page faults read from a file. */
+    unsigned swap_faults;       /* Page faults read from swap. */
+    unsigned stack_faults;      /* Page faults that grew the stack. */
+    unsigned long long block_reads;  /* # of sectors read for it. */
+    unsigned long long block_writes; /* # of sectors it made dirty. */
+  };
+
+#endif /* lib/rusage.h */
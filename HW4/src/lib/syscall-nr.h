@@ -32,7 +32,14 @@ enum
   SYS_MKDIR,   /* Create a directory. */
   SYS_READDIR, /* Reads a directory entry. */
   SYS_ISDIR,   /* Tests if a fd represents a directory. */
-  SYS_INUMBER  /* Returns the inode number for a fd. */
+  SYS_INUMBER, /* Returns the inode number for a fd. */
+
+  /* Extensions. */
+  SYS_LOCKSTAT,   /* Reads kernel lock contention statistics. */
+  SYS_FUTEX_WAIT, /* Sleeps on a user-space mutex. */
+  SYS_FUTEX_WAKE, /* Wakes threads sleeping on a user-space mutex. */
+  SYS_GETRUSAGE,  /* Reads resource usage of a process. */
+  SYS_SCHED_SETQUOTA /* Limits the CPU share of a process tree. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,47 @@
+#ifndef __LIB_TIMEPAGE_H
+#define __LIB_TIMEPAGE_H
+
+#include <stdint.h>
+
+/* High-resolution monotonic clock.
+
+   The kernel calibrates the CPU's time-stamp counter (TSC)
+   against the 8254 timer at boot and publishes the result in a
+   page that it maps read-only into every process at TIMEPAGE.
+   The kernel and user programs alike then read the clock with
+   timepage_ns(), without a system call. */
+
+/* User virtual address of the time page. */
+#define TIMEPAGE ((const struct timepage *) 0x08000000)
+
+/* Contents of the time page. */
+struct timepage
+  {
+    uint64_t tsc_base;          /* TSC value at time 0. */
+    uint32_t mult;              /* Nanoseconds per cycle << SHIFT. */
+    uint32_t shift;             /* Fixed-point shift of MULT. */
+  };
+
+/* Reads the time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Returns the number of nanoseconds since the clock in TP
+   started. */
+static inline int64_t
+timepage_ns (const struct timepage *tp)
+{
+  uint64_t cycles = rdtsc () - tp->tsc_base;
+  uint64_t hi = cycles >> 32, lo = cycles & 0xffffffff;
+
+  /* Splitting CYCLES keeps each product within 64 bits. */
+  return ((hi * tp->mult) << (32 - tp->shift))
+         + ((lo * tp->mult) >> tp->shift);
+}
+
+#endif /* lib/timepage.h */
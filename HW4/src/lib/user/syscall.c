@@ -185,3 +185,28 @@ int max_of_four_int(int x, int y, int z, int w)
 {
   return syscall4(SYS_MAX_OF_FOUR_INT, x, y, z, w);
 }
+
+bool lockstat(unsigned idx, struct lockstat *buf)
+{
+  return syscall2(SYS_LOCKSTAT, idx, buf);
+}
+
+int futex_wait(int *addr, int expected, int timeout)
+{
+  return syscall3(SYS_FUTEX_WAIT, addr, expected, timeout);
+}
+
+int futex_wake(int *addr, int cnt)
+{
+  return syscall2(SYS_FUTEX_WAKE, addr, cnt);
+}
+
+int getrusage(int who, struct rusage *usage)
+{
+  return syscall2(SYS_GETRUSAGE, who, usage);
+}
+
+int sched_setquota(int percent)
+{
+  return syscall1(SYS_SCHED_SETQUOTA, percent);
+}
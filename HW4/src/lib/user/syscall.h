@@ -49,4 +49,13 @@ bool readdir(int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir(int fd);
 int inumber(int fd);
 
+/* Extensions. */
+struct lockstat;
+bool lockstat(unsigned idx, struct lockstat *);
+int futex_wait(int *addr, int expected, int timeout);
+int futex_wake(int *addr, int cnt);
+struct rusage;
+int getrusage(int who, struct rusage *);
+int sched_setquota(int percent);
+
 #endif /* lib/user/syscall.h */
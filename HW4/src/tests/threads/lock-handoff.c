@@ -0,0 +1,86 @@
+/* Measures a lock under heavy contention, first in the default
+   mode and then as a hand-off lock (see lock_set_handoff()).
+
+   Eight threads each acquire the same lock many times, yielding
+   inside every fourth critical section so that waiters pile up.
+   Each run reports how long it took and the largest number of
+   acquisitions any thread had to let through between asking for
+   the lock and getting it.  That number must stay bounded for
+   the hand-off lock. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 8
+#define ITER_CNT 1000
+#define BYPASS_MAX (THREAD_CNT * 8)
+
+static struct lock lock;
+static struct semaphore done;
+static unsigned acquire_cnt;    /* # of acquisitions so far. */
+static unsigned max_bypass;     /* Most acquisitions ahead of a waiter. */
+
+static thread_func lock_thread;
+static void run (const char *mode, bool handoff);
+
+void
+test_lock_handoff (void) 
+{
+  run ("barging", false);
+  run ("hand-off", true);
+}
+
+/* Runs the workload once on a lock in the given mode. */
+static void
+run (const char *mode, bool handoff) 
+{
+  int64_t start;
+  int i;
+
+  lock_init (&lock);
+  lock_set_handoff (&lock, handoff);
+  sema_init (&done, 0);
+  acquire_cnt = max_bypass = 0;
+
+  start = timer_ns ();
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "locker %d", i);
+      thread_create (name, PRI_DEFAULT, lock_thread, NULL);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+
+  msg ("%s: %u acquisitions in %"PRId64" us, longest bypass %u",
+       mode, acquire_cnt, (timer_ns () - start) / 1000, max_bypass);
+  if (acquire_cnt != THREAD_CNT * ITER_CNT)
+    fail ("%s: expected %d acquisitions", mode, THREAD_CNT * ITER_CNT);
+  if (handoff && max_bypass > BYPASS_MAX)
+    fail ("%s: waiter bypassed %u times, limit is %d",
+          mode, max_bypass, BYPASS_MAX);
+}
+
+static void
+lock_thread (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < ITER_CNT; i++) 
+    {
+      unsigned requested = acquire_cnt;
+
+      lock_acquire (&lock);
+      if (acquire_cnt - requested > max_bypass)
+        max_bypass = acquire_cnt - requested;
+      acquire_cnt++;
+      if (i % 4 == 0)
+        thread_yield ();
+      lock_release (&lock);
+    }
+  sema_up (&done);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# The timings vary from run to run, so just check that both runs
+# finished.  The test itself fails if a hand-off waiter starved.
+foreach my $mode ('barging', 'hand-off') {
+    fail "missing result for $mode lock\n"
+      if !grep (/^\(lock-handoff\) $mode: \d+ acquisitions in \d+ us, /,
+		@output);
+}
+pass;
@@ -0,0 +1,22 @@
+/* Child process run by sched-quota.
+   Spins in user mode until the time given on its command line,
+   in milliseconds on the timepage_ns() clock. */
+
+#include <stdlib.h>
+#include <timepage.h>
+#include "tests/lib.h"
+
+int
+main (int argc, char *argv[])
+{
+  long long deadline;
+
+  test_name = "child-spin";
+
+  if (argc != 2)
+    fail ("usage: child-spin DEADLINE");
+  deadline = atoi (argv[1]) * 1000000LL;
+  while (timepage_ns (TIMEPAGE) < deadline)
+    continue;
+  return 0;
+}
@@ -0,0 +1,19 @@
+/* Exercises futex_wait() and futex_wake() within one process:
+   a wait on a value that has already changed must return at
+   once, a wait with a timeout must give up, and a wake with no
+   waiters must wake nobody. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int futex;
+
+void
+test_main (void) 
+{
+  CHECK (futex_wait (&futex, 1, -1) == -1,
+         "wait for value that does not match");
+  CHECK (futex_wait (&futex, 0, 10) == -1, "wait with timeout");
+  CHECK (futex_wake (&futex, 1) == 0, "wake without waiters");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-basic) begin
+(futex-basic) wait for value that does not match
+(futex-basic) wait with timeout
+(futex-basic) wake without waiters
+(futex-basic) end
+futex-basic: exit(0)
+EOF
+pass;
@@ -0,0 +1,25 @@
+/* Checks that getrusage() rejects a bad WHO, and that the usage
+   of a child is added to the parent's RUSAGE_CHILDREN totals
+   once the parent waits for it. */
+
+#include <rusage.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct rusage ru;
+
+  CHECK (getrusage (1, &ru) == -1, "getrusage with bad who");
+  CHECK (getrusage (RUSAGE_CHILDREN, &ru) == 0, "getrusage before wait");
+  CHECK (ru.file_faults == 0, "no child faults yet");
+
+  wait (exec ("child-simple"));
+  CHECK (getrusage (RUSAGE_CHILDREN, &ru) == 0, "getrusage after wait");
+  CHECK (ru.file_faults > 0, "child faulted in its code");
+
+  CHECK (getrusage (RUSAGE_SELF, &ru) == 0, "getrusage of self");
+  CHECK (ru.voluntary_switches > 0, "self blocked in wait");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rusage-child) begin
+(rusage-child) getrusage with bad who
+(rusage-child) getrusage before wait
+(rusage-child) no child faults yet
+(child-simple) run
+child-simple: exit(81)
+(rusage-child) getrusage after wait
+(rusage-child) child faulted in its code
+(rusage-child) getrusage of self
+(rusage-child) self blocked in wait
+(rusage-child) end
+rusage-child: exit(0)
+EOF
+pass;
@@ -0,0 +1,54 @@
+/* Checks that sched_setquota() validates its argument and keeps
+   the caller in the group it created on later calls.  Then runs
+   two children that spin side by side until the same deadline,
+   one outside any group and one in a group capped at 20% of the
+   CPU, and checks that the capped one gets much less CPU time. */
+
+#include <rusage.h>
+#include <stdio.h>
+#include <syscall.h>
+#include <timepage.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* How long the children spin, in milliseconds. */
+#define SPIN_MS 2000
+
+/* Waits for child PID and returns the user ticks it used. */
+static long long
+child_user_ticks (pid_t pid)
+{
+  struct rusage ru;
+  long long before;
+
+  CHECK (getrusage (RUSAGE_CHILDREN, &ru) == 0, "getrusage before wait");
+  before = ru.user_ticks;
+  CHECK (wait (pid) == 0, "wait for child");
+  CHECK (getrusage (RUSAGE_CHILDREN, &ru) == 0, "getrusage after wait");
+  return ru.user_ticks - before;
+}
+
+void
+test_main (void)
+{
+  char cmd[32];
+  pid_t free_pid, capped_pid;
+  long long free_ticks, capped_ticks;
+  int id;
+
+  CHECK (sched_setquota (0) == -1, "sched_setquota(0) fails");
+  CHECK (sched_setquota (101) == -1, "sched_setquota(101) fails");
+
+  snprintf (cmd, sizeof cmd, "child-spin %d",
+            (int) (timepage_ns (TIMEPAGE) / 1000000) + SPIN_MS);
+  CHECK ((free_pid = exec (cmd)) != -1, "exec child outside any group");
+  CHECK ((id = sched_setquota (100)) > 0, "create group");
+  CHECK (sched_setquota (20) == id, "change quota of same group");
+  CHECK ((capped_pid = exec (cmd)) != -1, "exec child in group");
+
+  quiet = true;
+  capped_ticks = child_user_ticks (capped_pid);
+  free_ticks = child_user_ticks (free_pid);
+  quiet = false;
+  CHECK (capped_ticks * 2 < free_ticks, "capped child got less CPU");
+}
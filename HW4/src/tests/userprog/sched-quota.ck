@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(sched-quota) begin
+(sched-quota) sched_setquota(0) fails
+(sched-quota) sched_setquota(101) fails
+(sched-quota) exec child outside any group
+(sched-quota) create group
+(sched-quota) change quota of same group
+(sched-quota) exec child in group
+(sched-quota) capped child got less CPU
+(sched-quota) end
+EOF
+pass;
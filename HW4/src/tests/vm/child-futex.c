@@ -0,0 +1,36 @@
+/* Child process of futex-shared.
+   Maps the file that futex-shared is sleeping on a futex in and
+   wakes that futex through its own mapping, retrying until the
+   parent has gone to sleep. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+
+#define ACTUAL ((int *) 0x20000000)
+
+/* Number of times to try waking the parent, 10 ms apart. */
+#define TRY_CNT 1000
+
+int
+main (void)
+{
+  int dummy = 0;
+  int handle;
+  int i;
+
+  test_name = "child-futex";
+
+  if ((handle = open ("futex")) < 2)
+    fail ("open \"futex\"");
+  if (mmap (handle, ACTUAL) == MAP_FAILED)
+    fail ("mmap \"futex\"");
+
+  /* A wait on a private futex that nobody wakes is a sleep. */
+  for (i = 0; i < TRY_CNT; i++)
+    if (futex_wake (ACTUAL, 1) == 1)
+      return 0;
+    else
+      futex_wait (&dummy, 0, 10);
+  fail ("parent never slept on the futex");
+  return 1;
+}
@@ -0,0 +1,26 @@
+/* Maps a file and sleeps on a futex in it, while child-futex
+   maps the same file and wakes the futex at the same offset.
+   Processes share a futex only through a file they both map. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((int *) 0x10000000)
+
+void
+test_main (void)
+{
+  int handle;
+  pid_t child;
+
+  CHECK (create ("futex", sizeof *ACTUAL), "create \"futex\"");
+  CHECK ((handle = open ("futex")) > 1, "open \"futex\"");
+  CHECK (mmap (handle, ACTUAL) != MAP_FAILED, "mmap \"futex\"");
+
+  quiet = true;
+  CHECK ((child = exec ("child-futex")) != -1, "exec \"child-futex\"");
+  quiet = false;
+  CHECK (futex_wait (ACTUAL, 0, 10000) == 0, "wait for child to wake us");
+  CHECK (wait (child) == 0, "wait for child (should return 0)");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(futex-shared) begin
+(futex-shared) create "futex"
+(futex-shared) open "futex"
+(futex-shared) mmap "futex"
+(futex-shared) wait for child to wake us
+(futex-shared) wait for child (should return 0)
+(futex-shared) end
+EOF
+pass;
@@ -20,11 +20,15 @@
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 
+#ifdef VM
 #include "vm/frame.h"
 #include "vm/swap.h"
+#endif
 
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -102,9 +106,11 @@ int main(void)
   malloc_init();
   paging_init();
 
+#ifdef VM
   /* Project 4 */
   frame_init();
   swap_init();
+#endif
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -126,6 +132,7 @@ int main(void)
   thread_start();
   serial_init_queue();
   timer_calibrate();
+  workqueue_init();
 
 #ifdef FILESYS
   /* Initialize file system. */
@@ -263,6 +270,8 @@ parse_options(char **argv)
       random_init(atoi(value));
     else if (!strcmp(name, "-mlfqs"))
       thread_mlfqs = true;
+    else if (!strcmp(name, "-profile"))
+      profile_enabled = true;
 #ifdef USERPROG
     else if (!strcmp(name, "-ul"))
       user_page_limit = atoi(value);
@@ -385,6 +394,7 @@ usage(void)
 #endif
          "  -rs=SEED           Set random number seed to SEED.\n"
          "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+         "  -profile           Sample kernel execution, report at shutdown.\n"
 #ifdef USERPROG
          "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
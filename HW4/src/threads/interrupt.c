@@ -384,8 +384,13 @@ intr_handler (struct intr_frame *frame)
       pic_end_of_interrupt (frame->vec_no); 
 
       if (yield_on_return) 
-        thread_yield (); 
+        thread_preempt (); 
     }
+
+  /* Returning to user mode, the thread holds no kernel locks, so
+     this is where it waits out its scheduling group's quota. */
+  if ((frame->cs & 3) == 3)
+    thread_return_to_user ();
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
@@ -41,6 +41,9 @@ struct desc
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
+#ifdef LOCK_PROFILE
+    char name[16];              /* Name of `lock' in lock profiles. */
+#endif
   };
 
 /* Magic number for detecting arena corruption. */
@@ -81,6 +84,11 @@ malloc_init (void)
       d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
       list_init (&d->free_list);
       lock_init (&d->lock);
+      lock_set_handoff (&d->lock, true);
+#ifdef LOCK_PROFILE
+      snprintf (d->name, sizeof d->name, "malloc %zu", block_size);
+      lock_register (&d->lock, d->name);
+#endif
     }
 }
 
@@ -0,0 +1,185 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <hash.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Sampling profiler.
+
+   When enabled, the timer interrupt handler passes every
+   interrupted frame to profile_sample(), which counts samples
+   by kernel code address and by thread in preallocated tables,
+   so that sampling never allocates memory.  At shutdown,
+   profile_print_stats() reports the hottest addresses, which
+   utils/profile-report resolves to functions and source lines
+   using utils/backtrace.
+
+   Code that runs with interrupts disabled is never sampled, so
+   its time is charged to wherever interrupts get turned back
+   on. */
+
+bool profile_enabled;
+
+/* Kernel code addresses, in an open-addressed hash table. */
+#define EIP_SLOT_CNT 2048
+struct eip_slot
+  {
+    uintptr_t eip;              /* Sampled address, 0 if unused. */
+    unsigned cnt;               /* # of samples. */
+  };
+static struct eip_slot eip_slots[EIP_SLOT_CNT];
+static bool eip_reported[EIP_SLOT_CNT]; /* Used while reporting. */
+
+/* Per-thread sample counts.  Threads beyond the first
+   THREAD_SLOT_CNT sampled are only counted in the totals. */
+#define THREAD_SLOT_CNT 32
+struct thread_slot
+  {
+    int tid;                    /* Thread identifier. */
+    char name[16];              /* Name when first sampled. */
+    unsigned kernel_cnt;        /* # of samples in kernel mode. */
+    unsigned user_cnt;          /* # of samples in user mode. */
+  };
+static struct thread_slot thread_slots[THREAD_SLOT_CNT];
+static size_t thread_slot_cnt;
+
+/* Number of hot spots to report. */
+#define REPORT_CNT 64
+
+/* Totals. */
+static unsigned sample_cnt;     /* # of samples. */
+static unsigned user_cnt;       /* # of samples in user mode. */
+static unsigned idle_cnt;       /* # of samples in the idle thread. */
+static unsigned dropped_cnt;    /* # of kernel samples not recorded. */
+
+static void count_eip (uintptr_t eip);
+static void count_thread (const struct thread *, bool user);
+static void print_percent (unsigned part, unsigned total);
+
+/* Records a sample of the code interrupted by a timer tick,
+   whose state is in F. */
+void
+profile_sample (const struct intr_frame *f) 
+{
+  struct thread *t = thread_current ();
+  bool user = (f->cs & 3) == 3;    /* Interrupted at ring 3? */
+
+  ASSERT (intr_context ());
+
+  sample_cnt++;
+  if (thread_is_idle (t))
+    {
+      idle_cnt++;
+      return;
+    }
+  if (user)
+    user_cnt++;
+  else
+    count_eip ((uintptr_t) f->eip);
+  count_thread (t, user);
+}
+
+/* Prints the samples collected, if profiling is enabled. */
+void
+profile_print_stats (void) 
+{
+  unsigned kernel_cnt = sample_cnt - user_cnt - idle_cnt;
+  size_t i, n;
+
+  if (!profile_enabled)
+    return;
+
+  printf ("Profile: %u samples, %u kernel, %u user, %u idle, "
+          "%u dropped\n", sample_cnt, kernel_cnt, user_cnt, idle_cnt,
+          dropped_cnt);
+
+  printf ("Profile threads:\n");
+  for (i = 0; i < thread_slot_cnt; i++)
+    {
+      struct thread_slot *s = &thread_slots[i];
+      printf ("  %-16s tid %3d: %6u kernel %6u user\n",
+              s->name, s->tid, s->kernel_cnt, s->user_cnt);
+    }
+
+  /* Report the hottest kernel addresses, most samples first. */
+  printf ("Profile hot spots:\n");
+  memset (eip_reported, 0, sizeof eip_reported);
+  for (n = 0; n < REPORT_CNT; n++)
+    {
+      struct eip_slot *max = NULL;
+
+      for (i = 0; i < EIP_SLOT_CNT; i++)
+        if (eip_slots[i].eip != 0 && !eip_reported[i]
+            && (max == NULL || eip_slots[i].cnt > max->cnt))
+          max = &eip_slots[i];
+      if (max == NULL)
+        break;
+      eip_reported[max - eip_slots] = true;
+
+      printf ("  %6u ", max->cnt);
+      print_percent (max->cnt, kernel_cnt);
+      printf (" %#010"PRIxPTR"\n", max->eip);
+    }
+}
+
+/* Counts a kernel-mode sample at EIP. */
+static void
+count_eip (uintptr_t eip) 
+{
+  size_t start = hash_int (eip) % EIP_SLOT_CNT;
+  size_t i = start;
+
+  do
+    {
+      struct eip_slot *s = &eip_slots[i];
+      if (s->eip == eip || s->eip == 0)
+        {
+          s->eip = eip;
+          s->cnt++;
+          return;
+        }
+      i = (i + 1) % EIP_SLOT_CNT;
+    }
+  while (i != start);
+
+  dropped_cnt++;
+}
+
+/* Counts a sample of thread T, which was in user mode if USER
+   is true. */
+static void
+count_thread (const struct thread *t, bool user) 
+{
+  struct thread_slot *s;
+  size_t i;
+
+  for (i = 0; i < thread_slot_cnt; i++)
+    if (thread_slots[i].tid == t->tid)
+      break;
+  if (i == thread_slot_cnt)
+    {
+      if (thread_slot_cnt >= THREAD_SLOT_CNT)
+        return;
+      s = &thread_slots[thread_slot_cnt++];
+      s->tid = t->tid;
+      strlcpy (s->name, t->name, sizeof s->name);
+    }
+  s = &thread_slots[i];
+
+  if (user)
+    s->user_cnt++;
+  else
+    s->kernel_cnt++;
+}
+
+/* Prints PART as a percentage of TOTAL, to one decimal place. */
+static void
+print_percent (unsigned part, unsigned total) 
+{
+  unsigned permille = total > 0 ? (uint64_t) part * 1000 / total : 0;
+  printf ("%3u.%u%%", permille / 10, permille % 10);
+}
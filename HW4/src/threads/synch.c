@@ -31,6 +31,17 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#ifdef LOCK_PROFILE
+#include <lockstat.h>
+#include "devices/timer.h"
+
+/* Locks registered with lock_register(), in registration
+   order. */
+static struct list profiled_locks = LIST_INITIALIZER (profiled_locks);
+
+static void profile_acquired (struct lock *, int64_t start, bool contended);
+static void profile_released (struct lock *);
+#endif
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -179,6 +190,39 @@ lock_init (struct lock *lock)
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->handoff = false;
+  lock->passes = 0;
+#ifdef LOCK_PROFILE
+  memset (&lock->profile, 0, sizeof lock->profile);
+#endif
+}
+
+/* Number of times the first thread waiting for a hand-off lock
+   may lose the race for the released lock to a running thread
+   before the lock is handed to it directly. */
+#define LOCK_HANDOFF_PASSES 2
+
+/* Sets whether LOCK is a hand-off lock.
+
+   By default, releasing a lock just wakes its first waiter,
+   which must then race for the lock against whichever thread is
+   running by the time it gets scheduled, most often the thread
+   that released it.  That keeps the lock busy, but a waiter can
+   lose that race indefinitely.
+
+   Releasing a hand-off lock instead makes the first waiter the
+   holder at once, once it has lost the race LOCK_HANDOFF_PASSES
+   times.  The bound keeps any waiter from starving, while the
+   races it still allows let a running thread take a lock back
+   without a context switch, so that a short critical section
+   does not turn into a convoy in which every acquisition waits
+   for the scheduler. */
+void
+lock_set_handoff (struct lock *lock, bool handoff) 
+{
+  ASSERT (lock != NULL);
+
+  lock->handoff = handoff;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -192,12 +236,43 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
-  sema_down (&lock->semaphore);
-  lock->holder = thread_current ();
+#ifdef LOCK_PROFILE
+  int64_t start = timer_ticks ();
+  bool contended = lock->semaphore.value == 0;
+#endif
+  /* This is sema_down(), except that a waiter that loses the
+     race keeps its place at the head of the queue, and that
+     lock_release() may make us the holder while we sleep. */
+  old_level = intr_disable ();
+  if (lock->semaphore.value == 0)
+    {
+      list_push_back (&lock->semaphore.waiters, &cur->elem);
+      for (;;)
+        {
+          thread_block ();
+          if (lock->holder == cur || lock->semaphore.value > 0)
+            break;
+          lock->passes++;
+          list_push_front (&lock->semaphore.waiters, &cur->elem);
+        }
+      lock->passes = 0;
+    }
+  if (lock->holder != cur)
+    {
+      lock->semaphore.value--;
+      lock->holder = cur;
+    }
+  intr_set_level (old_level);
+#ifdef LOCK_PROFILE
+  profile_acquired (lock, start, contended);
+#endif
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -216,7 +291,12 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      lock->holder = thread_current ();
+#ifdef LOCK_PROFILE
+      profile_acquired (lock, timer_ticks (), false);
+#endif
+    }
   return success;
 }
 
@@ -228,11 +308,29 @@ lock_try_acquire (struct lock *lock)
 void
 lock_release (struct lock *lock) 
 {
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
-  lock->holder = NULL;
-  sema_up (&lock->semaphore);
+#ifdef LOCK_PROFILE
+  profile_released (lock);
+#endif
+  old_level = intr_disable ();
+  if (lock->handoff && lock->passes >= LOCK_HANDOFF_PASSES
+      && !list_empty (&lock->semaphore.waiters))
+    {
+      /* Hand the lock over without ever making it free. */
+      lock->holder = list_entry (list_pop_front (&lock->semaphore.waiters),
+                                 struct thread, elem);
+      thread_unblock (lock->holder);
+    }
+  else
+    {
+      lock->holder = NULL;
+      sema_up (&lock->semaphore);
+    }
+  intr_set_level (old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -246,6 +344,104 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
+#ifdef LOCK_PROFILE
+/* Registers LOCK, which must already be initialized, under
+   NAME, so that its statistics show up in lock_print_stats()
+   and the lockstat system call.  NAME must stay valid for as
+   long as LOCK exists. */
+void
+lock_register (struct lock *lock, const char *name)
+{
+  enum intr_level old_level;
+
+  ASSERT (lock != NULL);
+  ASSERT (name != NULL);
+  ASSERT (lock->profile.name == NULL);
+
+  lock->profile.name = name;
+  old_level = intr_disable ();
+  list_push_back (&profiled_locks, &lock->profile.elem);
+  intr_set_level (old_level);
+}
+
+/* Copies the statistics of the IDX'th registered lock into
+   *STATS.  Returns false if fewer than IDX + 1 locks are
+   registered. */
+bool
+lock_get_stats (unsigned idx, struct lockstat *stats)
+{
+  enum intr_level old_level = intr_disable ();
+  struct list_elem *e;
+  bool found = false;
+
+  for (e = list_begin (&profiled_locks); e != list_end (&profiled_locks);
+       e = list_next (e))
+    if (idx-- == 0)
+      {
+        struct lock_profile *p = list_entry (e, struct lock_profile, elem);
+        strlcpy (stats->name, p->name, sizeof stats->name);
+        stats->acquire_cnt = p->acquire_cnt;
+        stats->contended_cnt = p->contended_cnt;
+        stats->wait_ticks = p->wait_ticks;
+        stats->max_wait_ticks = p->max_wait_ticks;
+        stats->hold_ticks = p->hold_ticks;
+        stats->max_hold_ticks = p->max_hold_ticks;
+        found = true;
+        break;
+      }
+  intr_set_level (old_level);
+
+  return found;
+}
+
+/* Prints contention statistics for every registered lock. */
+void
+lock_print_stats (void)
+{
+  struct lockstat stats;
+  unsigned i;
+
+  printf ("Locks:\n");
+  for (i = 0; lock_get_stats (i, &stats); i++)
+    printf ("  %-12s %u acquires, %u contended, "
+            "wait %lld ticks (max %lld), hold %lld ticks (max %lld)\n",
+            stats.name, stats.acquire_cnt, stats.contended_cnt,
+            stats.wait_ticks, stats.max_wait_ticks,
+            stats.hold_ticks, stats.max_hold_ticks);
+}
+
+/* Records that the current thread acquired LOCK after starting
+   to wait for it at tick START.  Runs with LOCK held, which
+   serializes updates to its statistics. */
+static void
+profile_acquired (struct lock *lock, int64_t start, bool contended)
+{
+  struct lock_profile *p = &lock->profile;
+  int64_t now = timer_ticks ();
+  int64_t wait = now - start;
+
+  p->acquire_cnt++;
+  if (contended)
+    p->contended_cnt++;
+  p->wait_ticks += wait;
+  if (wait > p->max_wait_ticks)
+    p->max_wait_ticks = wait;
+  p->acquired_at = now;
+}
+
+/* Records that the current thread is about to release LOCK. */
+static void
+profile_released (struct lock *lock)
+{
+  struct lock_profile *p = &lock->profile;
+  int64_t hold = timer_ticks () - p->acquired_at;
+
+  p->hold_ticks += hold;
+  if (hold > p->max_hold_ticks)
+    p->max_hold_ticks = hold;
+}
+#endif /* LOCK_PROFILE */
+
 /* One semaphore in a list. */
 struct semaphore_elem 
   {
@@ -336,3 +532,133 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Initializes reader-writer lock RW.  Any number of readers may
+   hold RW at once, or a single writer may hold it alone.
+
+   Waiting writers are preferred over newly arriving readers, so
+   a steady stream of readers cannot starve a writer.  To keep
+   writers from starving readers in turn, a writer releasing RW
+   admits every reader that was already waiting at that moment,
+   even if more writers are queued; readers that arrive later
+   wait behind those writers. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  cond_init (&rw->readers);
+  cond_init (&rw->writers);
+  rw->active_readers = 0;
+  rw->waiting_readers = 0;
+  rw->waiting_writers = 0;
+  rw->reader_pass = 0;
+  rw->reader_generation = 0;
+  rw->writer = NULL;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or,
+   unless this reader was admitted by the last writer, while
+   writers are waiting.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != thread_current ());
+
+  lock_acquire (&rw->lock);
+  if (rw->writer != NULL || rw->waiting_writers > 0)
+    {
+      /* Only a writer release after this point lets this reader
+         past waiting writers. */
+      unsigned generation = rw->reader_generation;
+      bool admitted = false;
+
+      rw->waiting_readers++;
+      while (rw->writer != NULL
+             || (rw->waiting_writers > 0 && !admitted))
+        {
+          cond_wait (&rw->readers, &rw->lock);
+          admitted = rw->reader_generation != generation;
+        }
+      rw->waiting_readers--;
+      if (admitted)
+        rw->reader_pass--;
+    }
+  rw->active_readers++;
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread must hold for reading.
+   The last reader out hands RW to a waiting writer, if any. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->active_readers > 0);
+  if (--rw->active_readers == 0 && rw->waiting_writers > 0)
+    cond_signal (&rw->writers, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no reader or other
+   writer holds it and the readers admitted by the previous
+   writer have all gone through.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != thread_current ());
+
+  lock_acquire (&rw->lock);
+  rw->waiting_writers++;
+  while (rw->writer != NULL || rw->active_readers > 0
+         || rw->reader_pass > 0)
+    cond_wait (&rw->writers, &rw->lock);
+  rw->waiting_writers--;
+  rw->writer = thread_current ();
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread must hold for writing.
+   Readers that were waiting take precedence over the next
+   writer. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_by_current_thread (rw));
+
+  lock_acquire (&rw->lock);
+  rw->writer = NULL;
+  if (rw->waiting_readers > 0)
+    {
+      rw->reader_pass = rw->waiting_readers;
+      rw->reader_generation++;
+      cond_broadcast (&rw->readers, &rw->lock);
+    }
+  else if (rw->waiting_writers > 0)
+    cond_signal (&rw->writers, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise.  Readers are not tracked individually. */
+bool
+rwlock_held_by_current_thread (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
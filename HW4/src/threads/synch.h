@@ -3,6 +3,7 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* A counting semaphore. */
 struct semaphore 
@@ -17,19 +18,53 @@ bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
 
+#ifdef LOCK_PROFILE
+/* Contention statistics kept for each lock when the kernel is
+   built with -DLOCK_PROFILE. */
+struct lock_profile
+  {
+    const char *name;           /* Registered name, or null. */
+    struct list_elem elem;      /* Element in the registered lock list. */
+    unsigned acquire_cnt;       /* # of acquisitions. */
+    unsigned contended_cnt;     /* # of acquisitions that had to wait. */
+    int64_t wait_ticks;         /* Total ticks spent waiting. */
+    int64_t max_wait_ticks;     /* Longest wait. */
+    int64_t hold_ticks;         /* Total ticks held. */
+    int64_t max_hold_ticks;     /* Longest hold. */
+    int64_t acquired_at;        /* Tick of the current acquisition. */
+  };
+#endif
+
 /* Lock. */
 struct lock 
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    bool handoff;               /* Hand off to waiters on release? */
+    unsigned passes;            /* Races lost by the first waiter. */
+#ifdef LOCK_PROFILE
+    struct lock_profile profile; /* Contention statistics. */
+#endif
   };
 
 void lock_init (struct lock *);
+void lock_set_handoff (struct lock *, bool);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Lock contention profiling.  Without LOCK_PROFILE, registering
+   a lock compiles to nothing. */
+#ifdef LOCK_PROFILE
+struct lockstat;
+void lock_register (struct lock *, const char *name);
+bool lock_get_stats (unsigned idx, struct lockstat *);
+void lock_print_stats (void);
+#else
+#define lock_register(LOCK, NAME) ((void) (LOCK))
+#endif
+
 /* Condition variable. */
 struct condition 
   {
@@ -41,6 +76,27 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Reader-writer lock. */
+struct rwlock
+  {
+    struct lock lock;           /* Protects the members below. */
+    struct condition readers;   /* Signaled when readers may enter. */
+    struct condition writers;   /* Signaled when a writer may enter. */
+    unsigned active_readers;    /* # of readers holding the lock. */
+    unsigned waiting_readers;   /* # of readers waiting for the lock. */
+    unsigned waiting_writers;   /* # of writers waiting for the lock. */
+    unsigned reader_pass;       /* # of waiting readers let past writers. */
+    unsigned reader_generation; /* Incremented when readers are let past. */
+    struct thread *writer;      /* Writer holding the lock, if any. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
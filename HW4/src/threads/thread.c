@@ -7,10 +7,12 @@
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "filesys/file.h"
@@ -33,6 +35,46 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/* A scheduling group: a process and the descendants it creates
+   after calling thread_set_quota(), which share one CPU quota.
+   Once a group has used up its quota for the current period,
+   each of its threads is parked on `parked' the next time it is
+   about to return to user mode, until the next period begins.
+   Threads are never parked in the kernel, where they may hold
+   locks that other groups wait for, so a group may overrun its
+   quota by the time its threads spend in the kernel.
+
+   A group is freed when its last thread exits.  Its usage is
+   then added to the totals of retired groups, which are
+   reported at shutdown along with the groups still in use.
+   Only threads that call thread_set_quota() create groups.
+   Accessed with interrupts off. */
+struct sched_group
+{
+  int id;                 /* Group identifier. */
+  char name[16];          /* Name of the thread that created it. */
+  int leader;             /* Tid of the thread that created it. */
+  int thread_cnt;         /* # of threads in the group. */
+  int quota;              /* Ticks allowed per period, or -1. */
+  int used;               /* Ticks used in this period. */
+  bool throttled;         /* Used up its quota in this period? */
+  struct list parked;     /* Ready threads held back until next period. */
+  long long ticks;        /* Ticks used in total. */
+  unsigned throttle_cnt;  /* # of periods in which it was throttled. */
+  struct list_elem elem;  /* Element in group_list. */
+};
+
+/* Length of a quota period, in timer ticks. */
+#define SCHED_PERIOD TIMER_FREQ
+
+static struct list group_list;  /* All scheduling groups. */
+static int period_ticks;        /* Ticks elapsed in this period. */
+
+/* Usage of groups that have been freed. */
+static unsigned retired_groups;      /* # of groups freed. */
+static long long retired_ticks;      /* Ticks they used. */
+static unsigned retired_throttles;   /* Periods they were throttled. */
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame
 {
@@ -46,10 +88,25 @@ static long long idle_ticks;   /* # of timer ticks spent idle. */
 static long long kernel_ticks; /* # of timer ticks in kernel threads. */
 static long long user_ticks;   /* # of timer ticks in user programs. */
 
+/* Pages of exited threads, kept for reuse by thread_create() so
+   that process-heavy workloads don't round-trip every thread
+   page through the page allocator.  Accessed with interrupts
+   off. */
+#define THREAD_CACHE_SIZE 8
+static void *thread_cache[THREAD_CACHE_SIZE];
+static size_t thread_cache_cnt;
+static long long thread_cache_hits;   /* # of pages reused. */
+static long long thread_cache_misses; /* # of pages from palloc. */
+
 /* Scheduling. */
 #define TIME_SLICE 4          /* # of timer ticks to give each thread. */
 static unsigned thread_ticks; /* # of timer ticks since last yield. */
 
+/* True while thread_preempt() is switching away from the running
+   thread, so that schedule() can count the switch as
+   involuntary. */
+static bool preempting;
+
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
@@ -66,6 +123,10 @@ static void *alloc_frame(struct thread *, size_t size);
 static void schedule(void);
 void thread_schedule_tail(struct thread *prev);
 static int allocate_tid(void);
+static void *thread_page_get(void);
+static void sched_new_period(void);
+static void group_leave(struct thread *);
+static void thread_page_free(void *);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -85,8 +146,10 @@ void thread_init(void)
   ASSERT(intr_get_level() == INTR_OFF);
 
   lock_init(&tid_lock);
+  lock_register(&tid_lock, "tid_lock");
   list_init(&ready_list);
   list_init(&all_list);
+  list_init(&group_list);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread();
@@ -111,12 +174,33 @@ void thread_start(void)
   sema_down(&idle_started);
 }
 
-/* Called by the timer interrupt handler at each timer tick.
-   Thus, this function runs in an external interrupt context. */
-void thread_tick(void)
+/* Called by the timer interrupt handler at each timer tick, with
+   USER true if the tick interrupted user code.  Thus, this
+   function runs in an external interrupt context. */
+void thread_tick(bool user)
 {
   struct thread *t = thread_current();
 
+  if (user)
+    t->rusage.user_ticks++;
+  else
+    t->rusage.kernel_ticks++;
+
+  /* Charge the thread's scheduling group, throttling it once it
+     runs out of quota. */
+  struct sched_group *g = t->group;
+  if (g != NULL)
+  {
+    g->ticks++;
+    if (!g->throttled && g->quota >= 0 && ++g->used >= g->quota)
+    {
+      g->throttled = true;
+      g->throttle_cnt++;
+    }
+  }
+  if (++period_ticks >= SCHED_PERIOD)
+    sched_new_period();
+
   /* Update statistics. */
   if (t == idle_thread)
     idle_ticks++;
@@ -137,6 +221,142 @@ void thread_print_stats(void)
 {
   printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
          idle_ticks, kernel_ticks, user_ticks);
+  printf("Thread cache: %lld hits, %lld misses\n",
+         thread_cache_hits, thread_cache_misses);
+
+  struct list_elem *e;
+  for (e = list_begin(&group_list); e != list_end(&group_list);
+       e = list_next(e))
+  {
+    struct sched_group *g = list_entry(e, struct sched_group, elem);
+    printf("Sched group %d (%s): %lld ticks, ", g->id, g->name, g->ticks);
+    if (g->quota >= 0)
+      printf("quota %d%%, ", g->quota * 100 / SCHED_PERIOD);
+    else
+      printf("no quota, ");
+    printf("throttled in %u periods\n", g->throttle_cnt);
+  }
+  if (retired_groups > 0)
+    printf("Sched groups exited: %u, %lld ticks, throttled in %u periods\n",
+           retired_groups, retired_ticks, retired_throttles);
+}
+
+/* Moves the running thread into a new scheduling group, which
+   its child processes created from now on will share, and which
+   may use PERCENT percent of the CPU time in each period.  If
+   the running thread already created its group, just changes
+   that group's quota.  PERCENT must be between 1 and 100, where
+   100 removes the quota.  Returns the group's identifier, or -1
+   on failure. */
+int thread_set_quota(int percent)
+{
+  static int next_group_id = 1;
+  struct thread *cur = thread_current();
+  struct sched_group *g = cur->group;
+  enum intr_level old_level;
+
+  if (percent < 1 || percent > 100)
+    return -1;
+
+  if (g == NULL || g->leader != cur->tid)
+  {
+    g = malloc(sizeof *g);
+    if (g == NULL)
+      return -1;
+    strlcpy(g->name, cur->name, sizeof g->name);
+    g->leader = cur->tid;
+    g->thread_cnt = 1;
+    g->quota = -1;
+    g->used = 0;
+    g->throttled = false;
+    list_init(&g->parked);
+    g->ticks = 0;
+    g->throttle_cnt = 0;
+
+    group_leave(cur);
+    old_level = intr_disable();
+    g->id = next_group_id++;
+    list_push_back(&group_list, &g->elem);
+    cur->group = g;
+    intr_set_level(old_level);
+  }
+
+  g->quota = percent < 100 ? percent * SCHED_PERIOD / 100 : -1;
+  return g->id;
+}
+
+/* Starts a new quota period: resets every group's usage and
+   returns the threads parked by throttled groups to the ready
+   queue. */
+static void
+sched_new_period(void)
+{
+  struct list_elem *e;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  period_ticks = 0;
+  for (e = list_begin(&group_list); e != list_end(&group_list);
+       e = list_next(e))
+  {
+    struct sched_group *g = list_entry(e, struct sched_group, elem);
+    g->used = 0;
+    g->throttled = false;
+    while (!list_empty(&g->parked))
+      thread_unblock(list_entry(list_pop_front(&g->parked),
+                                struct thread, elem));
+  }
+}
+
+/* Called on every return to user mode.  If the running thread's
+   scheduling group has used up its quota, parks the thread until
+   the next period begins.  On its way back to user mode the
+   thread holds no kernel locks, so parking it cannot stall
+   threads of other groups. */
+void thread_return_to_user(void)
+{
+  struct thread *cur = thread_current();
+  enum intr_level old_level;
+
+  if (cur->group == NULL)
+    return;
+
+  old_level = intr_disable();
+  if (cur->group->throttled)
+  {
+    list_push_back(&cur->group->parked, &cur->elem);
+    preempting = true;
+    thread_block();
+  }
+  intr_set_level(old_level);
+}
+
+/* Takes T out of its scheduling group, if any, freeing the group
+   if T was its last thread. */
+static void
+group_leave(struct thread *t)
+{
+  struct sched_group *g = t->group;
+  enum intr_level old_level;
+  bool last;
+
+  if (g == NULL)
+    return;
+
+  old_level = intr_disable();
+  t->group = NULL;
+  last = --g->thread_cnt == 0;
+  if (last)
+  {
+    list_remove(&g->elem);
+    retired_groups++;
+    retired_ticks += g->ticks;
+    retired_throttles += g->throttle_cnt;
+  }
+  intr_set_level(old_level);
+
+  if (last)
+    free(g);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -166,7 +386,7 @@ int thread_create(const char *name, int priority,
   ASSERT(function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page(PAL_ZERO);
+  t = thread_page_get();
   if (t == NULL)
     return TID_ERROR;
 
@@ -257,6 +477,12 @@ thread_current(void)
   return t;
 }
 
+/* Returns true if T is the idle thread. */
+bool thread_is_idle(const struct thread *t)
+{
+  return t == idle_thread;
+}
+
 /* Returns the running thread's tid. */
 int thread_tid(void)
 {
@@ -272,6 +498,7 @@ void thread_exit(void)
 #ifdef USERPROG
   process_exit();
 #endif
+  group_leave(thread_current());
 
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
@@ -300,6 +527,15 @@ void thread_yield(void)
   intr_set_level(old_level);
 }
 
+/* Yields the CPU on behalf of an interrupt handler that called
+   intr_yield_on_return().  Otherwise the same as thread_yield(),
+   but accounted as an involuntary context switch. */
+void thread_preempt(void)
+{
+  preempting = true;
+  thread_yield();
+}
+
 /* Invoke function 'func' on all threads, passing along 'aux'.
    This function must be called with interrupts off. */
 void thread_foreach(thread_action_func *func, void *aux)
@@ -425,6 +661,42 @@ is_thread(struct thread *t)
   return t != NULL && t->magic == THREAD_MAGIC;
 }
 
+/* Returns a page for a new thread, reusing the page of an exited
+   thread if one is cached, or a null pointer if memory is not
+   available.  Only the struct thread part of the page is
+   reinitialized, by init_thread(), so there is no need for a
+   zeroed page. */
+static void *
+thread_page_get(void)
+{
+  enum intr_level old_level = intr_disable();
+  void *page = NULL;
+
+  if (thread_cache_cnt > 0)
+  {
+    page = thread_cache[--thread_cache_cnt];
+    thread_cache_hits++;
+  }
+  else
+    thread_cache_misses++;
+  intr_set_level(old_level);
+
+  return page != NULL ? page : palloc_get_page(0);
+}
+
+/* Frees PAGE, which held a thread that has exited, caching it
+   for reuse if there is room.  Runs with interrupts off. */
+static void
+thread_page_free(void *page)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (thread_cache_cnt < THREAD_CACHE_SIZE)
+    thread_cache[thread_cache_cnt++] = page;
+  else
+    palloc_free_page(page);
+}
+
 /* Does basic initialization of T as a blocked thread named
    NAME. */
 static void
@@ -447,6 +719,10 @@ init_thread(struct thread *t, const char *name, int priority)
   old_level = intr_disable();
   list_push_back(&all_list, &t->allelem);
 
+  t->group = running_thread()->group;
+  if (t->group != NULL)
+    t->group->thread_cnt++;
+
 #ifdef USERPROG
   t->parent = running_thread();
   sema_init(&(t->parent_lock), 0);
@@ -533,7 +809,7 @@ void thread_schedule_tail(struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread)
   {
     ASSERT(prev != cur);
-    palloc_free_page(prev);
+    thread_page_free(prev);
   }
 }
 
@@ -555,6 +831,15 @@ schedule(void)
   ASSERT(cur->status != THREAD_RUNNING);
   ASSERT(is_thread(next));
 
+  if (cur != next)
+  {
+    if (preempting)
+      cur->rusage.involuntary_switches++;
+    else
+      cur->rusage.voluntary_switches++;
+  }
+  preempting = false;
+
   if (cur != next)
     prev = switch_threads(cur, next);
   thread_schedule_tail(prev);
@@ -4,6 +4,7 @@
 #include <debug.h>
 #include <list.h>
 #include <hash.h>
+#include <rusage.h>
 #include <stdint.h>
 #include <threads/synch.h>
 #include <filesys/file.h>
@@ -82,6 +83,8 @@ enum thread_status
    only because they are mutually exclusive: only a thread in the
    ready state is on the run queue, whereas only a thread in the
    blocked state is on a semaphore wait list. */
+struct sched_group;
+struct dir;
 struct thread
 {
    /* Owned by thread.c. */
@@ -91,6 +94,9 @@ struct thread
    uint8_t *stack;            /* Saved stack pointer. */
    int priority;              /* Priority. */
    struct list_elem allelem;  /* List element for all threads list. */
+   struct rusage rusage;      /* Resources used by this thread. */
+   struct sched_group *group; /* Scheduling group, or null if none. */
+   int64_t wakeup;            /* Tick to wake at, in timer_sleep(). */
 
    /* Shared between thread.c and synch.c. */
    struct list_elem elem; /* List element. */
@@ -106,14 +112,20 @@ struct thread
    struct semaphore child_lock;
    struct list child_list;
    struct list_elem child_elem;
+   struct rusage child_rusage; /* Summed over children waited for. */
    /*****/
    struct file *fd[128];
+   struct inode *locked_inode; /* Inode a syscall holds locked. */
+   bool locked_inode_write;    /* Locked for writing? */
    /*****/
    struct file *file;
    struct hash pt;
    struct list map_list;
    unsigned int map_list_size;
 #endif
+#ifdef FILESYS
+   struct dir *cwd; /* Working directory, or null for the root. */
+#endif
 
    /* Owned by thread.c. */
    unsigned magic; /* Detects stack overflow. */
@@ -127,8 +139,10 @@ extern bool thread_mlfqs;
 void thread_init(void);
 void thread_start(void);
 
-void thread_tick(void);
+void thread_tick(bool user);
 void thread_print_stats(void);
+int thread_set_quota(int percent);
+void thread_return_to_user(void);
 
 typedef void thread_func(void *aux);
 int thread_create(const char *name, int priority, thread_func *, void *);
@@ -137,11 +151,13 @@ void thread_block(void);
 void thread_unblock(struct thread *);
 
 struct thread *thread_current(void);
+bool thread_is_idle(const struct thread *);
 int thread_tid(void);
 const char *thread_name(void);
 
 void thread_exit(void) NO_RETURN;
 void thread_yield(void);
+void thread_preempt(void);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func(struct thread *t, void *aux);
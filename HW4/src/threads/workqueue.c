@@ -0,0 +1,167 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Number of worker threads. */
+#define WORKER_CNT 2
+
+/* Queued work, one list per priority.  Protected by disabling
+   interrupts, so that interrupt handlers may submit work. */
+static struct list queues[WORK_PRI_CNT];
+
+/* Counts queued work items, so that idle workers sleep. */
+static struct semaphore work_avail;
+
+/* Number of work items currently being run. */
+static int busy_cnt;
+
+/* Threads waiting in workqueue_flush(). */
+static struct list flushers;
+
+/* A thread waiting for the work queue to drain. */
+struct flusher
+  {
+    struct list_elem elem;      /* Element in `flushers'. */
+    struct semaphore done;      /* Upped when the queue drains. */
+  };
+
+static thread_func worker;
+static bool queue_idle (void);
+
+/* Initializes the work queue and starts its worker threads.
+   Must be called after thread_start(). */
+void
+workqueue_init (void) 
+{
+  int i;
+
+  for (i = 0; i < WORK_PRI_CNT; i++)
+    list_init (&queues[i]);
+  sema_init (&work_avail, 0);
+  list_init (&flushers);
+
+  for (i = 0; i < WORKER_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "kworker %d", i);
+      if (thread_create (name, PRI_DEFAULT, worker, NULL) == TID_ERROR)
+        PANIC ("couldn't start work queue");
+    }
+}
+
+/* Initializes W to run FUNC when submitted. */
+void
+work_init (struct work *w, work_func *func) 
+{
+  ASSERT (w != NULL);
+  ASSERT (func != NULL);
+
+  w->func = func;
+  w->pending = false;
+}
+
+/* Queues W to be run by a worker thread at priority PRIORITY.
+   Returns false without doing anything if W is already queued
+   and has not started running yet, true otherwise.
+
+   This function may be called from an interrupt handler. */
+bool
+workqueue_submit (struct work *w, enum work_priority priority) 
+{
+  enum intr_level old_level;
+
+  ASSERT (w != NULL);
+  ASSERT (priority < WORK_PRI_CNT);
+
+  old_level = intr_disable ();
+  if (w->pending)
+    {
+      intr_set_level (old_level);
+      return false;
+    }
+  w->pending = true;
+  list_push_back (&queues[priority], &w->elem);
+  intr_set_level (old_level);
+
+  sema_up (&work_avail);
+  return true;
+}
+
+/* Waits until no work is queued or running.  Work submitted
+   while waiting is waited for as well. */
+void
+workqueue_flush (void) 
+{
+  struct flusher f;
+  enum intr_level old_level;
+
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  if (queue_idle ())
+    {
+      intr_set_level (old_level);
+      return;
+    }
+  sema_init (&f.done, 0);
+  list_push_back (&flushers, &f.elem);
+  intr_set_level (old_level);
+
+  sema_down (&f.done);
+}
+
+/* Worker thread.  Runs queued work forever. */
+static void
+worker (void *aux UNUSED) 
+{
+  for (;;) 
+    {
+      enum intr_level old_level;
+      struct work *w = NULL;
+      int i;
+
+      sema_down (&work_avail);
+
+      old_level = intr_disable ();
+      for (i = 0; i < WORK_PRI_CNT; i++)
+        if (!list_empty (&queues[i]))
+          {
+            w = list_entry (list_pop_front (&queues[i]), struct work, elem);
+            break;
+          }
+      ASSERT (w != NULL);
+      w->pending = false;
+      busy_cnt++;
+      intr_set_level (old_level);
+
+      w->func (w);
+
+      old_level = intr_disable ();
+      busy_cnt--;
+      if (queue_idle ())
+        while (!list_empty (&flushers))
+          sema_up (&list_entry (list_pop_front (&flushers),
+                                struct flusher, elem)->done);
+      intr_set_level (old_level);
+    }
+}
+
+/* Returns true if no work is queued or running.
+   Interrupts must be off. */
+static bool
+queue_idle (void) 
+{
+  int i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (busy_cnt > 0)
+    return false;
+  for (i = 0; i < WORK_PRI_CNT; i++)
+    if (!list_empty (&queues[i]))
+      return false;
+  return true;
+}
@@ -0,0 +1,46 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+
+/* Kernel work queue.
+
+   Deferred work is handed to a small, fixed pool of worker
+   threads instead of a freshly created thread per task.  The
+   caller embeds a struct work in its own data, initializes it
+   with work_init(), and queues it with workqueue_submit().  A
+   worker later runs the work's function, passing it the struct
+   work, from which list_entry()-style arithmetic recovers the
+   containing object.
+
+   A work item is off the queue by the time its function runs,
+   so the function may free it or submit it again. */
+
+/* Work priorities.  Workers always take the oldest item of the
+   most urgent nonempty priority. */
+enum work_priority
+  {
+    WORK_HIGH,                  /* Latency-sensitive work. */
+    WORK_NORMAL,                /* Ordinary deferred work. */
+    WORK_LOW,                   /* Background work. */
+    WORK_PRI_CNT                /* Number of priorities. */
+  };
+
+struct work;
+typedef void work_func (struct work *);
+
+/* A unit of deferred work. */
+struct work
+  {
+    struct list_elem elem;      /* Element in a work queue. */
+    work_func *func;            /* Function to run. */
+    bool pending;               /* Queued but not yet started? */
+  };
+
+void workqueue_init (void);
+void work_init (struct work *, work_func *);
+bool workqueue_submit (struct work *, enum work_priority);
+void workqueue_flush (void);
+
+#endif /* threads/workqueue.h */
@@ -146,13 +146,19 @@ page_fault(struct intr_frame *f)
       exit(-1);
 
    struct pt_entry *pte;
+   struct rusage *ru = &thread_current()->rusage;
    if (pte = pt_find(fault_addr))
    {
+      if (pte->type == SWAPPED)
+         ru->swap_faults++;
+      else
+         ru->file_faults++;
       if (!mm_fault_handler(pte))
          exit(-1);
    }
    else
    {
+      ru->stack_faults++;
       if (!expand_stack(fault_addr, f->esp))
          exit(-1);
    }
@@ -0,0 +1,218 @@
+#include "userprog/futex.h"
+#include <hash.h>
+#include <list.h>
+#include <stdint.h>
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+#include "vm/page.h"
+
+/* Fast user-space mutexes.
+
+   User programs keep their lock state in an ordinary int and
+   only call into the kernel to sleep when the lock is contended
+   (futex_wait) or to wake sleepers when releasing a contended
+   lock (futex_wake).  The kernel never interprets the int
+   beyond comparing it against an expected value.
+
+   Waiters are found by a key naming the memory the int lives
+   in rather than the frame that currently holds it, so that a
+   sleeper is not lost when its page is evicted and faulted back
+   in somewhere else.  For a page of a memory-mapped file, the
+   key is the file's inode plus the offset in the file, so that
+   processes mapping the same file share wait queues.  For any
+   other page, which is private to its process, it is the
+   process's page directory plus the user virtual address. */
+
+/* Number of wait queue buckets. */
+#define FUTEX_BUCKET_CNT 64
+
+/* Identifies the int that a futex lives in. */
+struct futex_key
+{
+  const void *object; /* Inode, or page directory of the process. */
+  uintptr_t offset;   /* Offset in the file, or user virtual address. */
+};
+
+/* A hash bucket of waiting threads. */
+struct futex_bucket
+{
+  struct lock lock;    /* Protects `waiters'. */
+  struct list waiters; /* List of struct futex_waiter. */
+};
+
+/* A thread waiting in futex_wait(). */
+struct futex_waiter
+{
+  struct list_elem elem;     /* Element in a bucket's `waiters'. */
+  struct futex_key key;      /* Futex waited on. */
+  struct semaphore sema;     /* Upped to wake the waiter. */
+  bool woken;                /* Removed from `waiters' by a waker? */
+};
+
+static struct futex_bucket buckets[FUTEX_BUCKET_CNT];
+
+static void get_key(int *uaddr, struct futex_key *key);
+static bool read_resident(const int *uaddr, int *value);
+static struct futex_bucket *get_bucket(const struct futex_key *key);
+static bool key_equal(const struct futex_key *a, const struct futex_key *b);
+
+void futex_init(void)
+{
+  for (int i = 0; i < FUTEX_BUCKET_CNT; i++)
+  {
+    lock_init(&buckets[i].lock);
+    list_init(&buckets[i].waiters);
+  }
+}
+
+/* Sleeps until woken by futex_wake() on UADDR, provided that
+   *UADDR equals EXPECTED to begin with.  Gives up after TIMEOUT
+   milliseconds, unless TIMEOUT is negative.  Returns 0 if woken,
+   -1 if *UADDR did not equal EXPECTED or the wait timed out. */
+int futex_wait(int *uaddr, int expected, int timeout)
+{
+  struct futex_key key;
+  struct futex_bucket *b;
+  struct futex_waiter w;
+  int value;
+
+  get_key(uaddr, &key);
+  b = get_bucket(&key);
+
+  /* Checking the value under the bucket lock means a waker that
+     changes it and then calls futex_wake() can't slip in
+     between the check and the sleep.  Touching UADDR may fault,
+     though, and a fault that kills the process must not happen
+     with the lock held, so if the page is not in memory, fault
+     it in first without the lock and try again. */
+  lock_acquire(&b->lock);
+  while (!read_resident(uaddr, &value))
+  {
+    lock_release(&b->lock);
+    value = *(volatile int *)uaddr;
+    lock_acquire(&b->lock);
+  }
+  if (value != expected)
+  {
+    lock_release(&b->lock);
+    return -1;
+  }
+  w.key = key;
+  w.woken = false;
+  sema_init(&w.sema, 0);
+  list_push_back(&b->waiters, &w.elem);
+  lock_release(&b->lock);
+
+  if (timeout < 0)
+  {
+    sema_down(&w.sema);
+    return 0;
+  }
+
+  /* Sleep until woken or out of time.  A waker may have taken us
+     off the bucket just as the time ran out, in which case its
+     sema_up() is on the way and the wakeup counts. */
+  int64_t ticks = DIV_ROUND_UP((int64_t)timeout * TIMER_FREQ, 1000);
+  if (!timer_sema_down(&w.sema, ticks))
+  {
+    bool woken;
+
+    lock_acquire(&b->lock);
+    woken = w.woken;
+    if (!woken)
+      list_remove(&w.elem);
+    lock_release(&b->lock);
+
+    if (!woken)
+      return -1;
+    sema_down(&w.sema);
+  }
+  return 0;
+}
+
+/* Wakes up to CNT threads waiting on UADDR, oldest first.
+   Returns the number woken. */
+int futex_wake(int *uaddr, int cnt)
+{
+  struct futex_key key;
+  struct futex_bucket *b;
+  struct list_elem *e;
+  int woken = 0;
+
+  get_key(uaddr, &key);
+  b = get_bucket(&key);
+
+  lock_acquire(&b->lock);
+  for (e = list_begin(&b->waiters);
+       e != list_end(&b->waiters) && woken < cnt;)
+  {
+    struct futex_waiter *w = list_entry(e, struct futex_waiter, elem);
+    if (key_equal(&w->key, &key))
+    {
+      e = list_remove(e);
+      w->woken = true;
+      sema_up(&w->sema);
+      woken++;
+    }
+    else
+      e = list_next(e);
+  }
+  lock_release(&b->lock);
+
+  return woken;
+}
+
+/* Computes the key for the futex at UADDR, terminating the
+   process if UADDR is not an aligned address in its memory. */
+static void get_key(int *uaddr, struct futex_key *key)
+{
+  struct pt_entry *pte;
+
+  if (!uaddr || !is_user_vaddr(uaddr) || (uintptr_t)uaddr % sizeof *uaddr)
+    exit(-1);
+  pte = pt_find(uaddr);
+  if (!pte)
+    exit(-1);
+
+  if (pte->type == MAPPED)
+  {
+    key->object = file_get_inode(pte->file);
+    key->offset = pte->offset + pg_ofs(uaddr);
+  }
+  else
+  {
+    key->object = thread_current()->pagedir;
+    key->offset = (uintptr_t)uaddr;
+  }
+}
+
+/* Reads the int at UADDR into *VALUE and returns true, if its
+   page is in memory, or returns false without touching UADDR.
+   Interrupts are turned off so that the page cannot be evicted
+   between the check and the read. */
+static bool read_resident(const int *uaddr, int *value)
+{
+  enum intr_level old_level = intr_disable();
+  const int *kaddr = pagedir_get_page(thread_current()->pagedir, uaddr);
+
+  if (kaddr != NULL)
+    *value = *kaddr;
+  intr_set_level(old_level);
+  return kaddr != NULL;
+}
+
+static struct futex_bucket *get_bucket(const struct futex_key *key)
+{
+  return &buckets[hash_bytes(key, sizeof *key) % FUTEX_BUCKET_CNT];
+}
+
+static bool key_equal(const struct futex_key *a, const struct futex_key *b)
+{
+  return a->object == b->object && a->offset == b->offset;
+}
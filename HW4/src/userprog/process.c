@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <timepage.h>
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
@@ -17,6 +18,7 @@
 #include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #include "vm/frame.h"
 #include "vm/swap.h"
 #include "vm/mmap.h"
@@ -24,6 +26,7 @@
 static thread_func start_process NO_RETURN;
 static bool load(const char *cmdline, void (**eip)(void), void **esp);
 static int parsing(char *buf, char **argv);
+static void rusage_add(struct rusage *, const struct rusage *);
 
 extern struct lock file_lock;
 
@@ -80,6 +83,16 @@ start_process(void *file_name_)
 
   pt_init(&(thread_current()->pt));
 
+  /* Start in the parent's working directory.  The parent waits
+     for us to finish loading, so it cannot change meanwhile. */
+  struct dir *cwd = thread_current()->parent->cwd;
+  if (cwd != NULL)
+  {
+    lock_acquire(&file_lock);
+    thread_current()->cwd = dir_reopen(cwd);
+    lock_release(&file_lock);
+  }
+
   memset(&if_, 0, sizeof if_);
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
@@ -96,6 +109,21 @@ start_process(void *file_name_)
   NOT_REACHED();
 }
 
+/* Adds the resource usage in B into A. */
+static void
+rusage_add(struct rusage *a, const struct rusage *b)
+{
+  a->user_ticks += b->user_ticks;
+  a->kernel_ticks += b->kernel_ticks;
+  a->voluntary_switches += b->voluntary_switches;
+  a->involuntary_switches += b->involuntary_switches;
+  a->file_faults += b->file_faults;
+  a->swap_faults += b->swap_faults;
+  a->stack_faults += b->stack_faults;
+  a->block_reads += b->block_reads;
+  a->block_writes += b->block_writes;
+}
+
 int process_wait(int child_tid UNUSED)
 {
   struct list *cur_list = &(thread_current()->child_list);
@@ -108,6 +136,8 @@ int process_wait(int child_tid UNUSED)
     if (entry->tid == child_tid)
     {
       sema_down(&(entry->parent_lock));
+      rusage_add(&thread_current()->child_rusage, &entry->rusage);
+      rusage_add(&thread_current()->child_rusage, &entry->child_rusage);
       list_remove(&(entry->child_elem));
       sema_up(&(entry->child_lock));
       return (entry->exit_status);
@@ -123,7 +153,11 @@ void process_exit(void)
   for (unsigned int i = 1; i < cur->map_list_size; i++)
     munmap(i);
 
+  lock_acquire(&file_lock);
   file_close(cur->file);
+  dir_close(cur->cwd);
+  cur->cwd = NULL;
+  lock_release(&file_lock);
   pt_destroy(&(cur->pt));
 
   uint32_t *pd = cur->pagedir;
@@ -131,6 +165,8 @@ void process_exit(void)
   {
     cur->pagedir = NULL;
     pagedir_activate(NULL);
+    /* The time page is shared, so it must not be freed. */
+    pagedir_clear_page(pd, (void *)TIMEPAGE);
     pagedir_destroy(pd);
   }
 
@@ -306,6 +342,11 @@ bool load(const char *file_name, void (**eip)(void), void **esp)
   if (!setup_stack(esp))
     goto done;
 
+  /* Map the clock calibration read-only, for timepage_ns(). */
+  if (timer_timepage() &&
+      !pagedir_set_page(t->pagedir, (void *)TIMEPAGE, timer_timepage(), false))
+    goto done;
+
   size_t total_len = 0, temp_len;
   for (i = argc - 1; i >= 0; i--)
   {
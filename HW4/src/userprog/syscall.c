@@ -9,14 +9,22 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
+#include "filesys/directory.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
+#include "userprog/futex.h"
 #include "vm/mmap.h"
+#include <lockstat.h>
 
 static void syscall_handler(struct intr_frame *);
+static void lock_inode(struct file *, bool write);
+static void unlock_inode(void);
 
 void syscall_init(void)
 {
   lock_init(&file_lock);
+  lock_register(&file_lock, "file_lock");
+  futex_init();
   intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
@@ -274,6 +282,162 @@ syscall_handler(struct intr_frame *f UNUSED)
     munmap(*(unsigned int *)((uint8_t *)esp + 4 * 1));
     break;
 
+  case SYS_CHDIR:
+    for (int i = 1; i <= 1; i++)
+    {
+      uint8_t *arg_addr = ((uint8_t *)esp + 4 * i);
+      if (arg_addr == NULL || is_user_vaddr(arg_addr) == false)
+        exit(-1);
+      if (!pt_find(arg_addr))
+      {
+        if (!expand_stack(arg_addr, esp))
+          exit(-1);
+      }
+    }
+    f->eax = chdir(*(char **)((uint8_t *)esp + 4 * 1));
+    break;
+
+  case SYS_MKDIR:
+    for (int i = 1; i <= 1; i++)
+    {
+      uint8_t *arg_addr = ((uint8_t *)esp + 4 * i);
+      if (arg_addr == NULL || is_user_vaddr(arg_addr) == false)
+        exit(-1);
+      if (!pt_find(arg_addr))
+      {
+        if (!expand_stack(arg_addr, esp))
+          exit(-1);
+      }
+    }
+    f->eax = mkdir(*(char **)((uint8_t *)esp + 4 * 1));
+    break;
+
+  case SYS_READDIR:
+    for (int i = 1; i <= 2; i++)
+    {
+      uint8_t *arg_addr = ((uint8_t *)esp + 4 * i);
+      if (arg_addr == NULL || is_user_vaddr(arg_addr) == false)
+        exit(-1);
+      if (!pt_find(arg_addr))
+      {
+        if (!expand_stack(arg_addr, esp))
+          exit(-1);
+      }
+    }
+    f->eax = readdir(*(int *)((uint8_t *)esp + 4 * 1),
+                     *(char **)((uint8_t *)esp + 4 * 2));
+    break;
+
+  case SYS_ISDIR:
+    for (int i = 1; i <= 1; i++)
+    {
+      uint8_t *arg_addr = ((uint8_t *)esp + 4 * i);
+      if (arg_addr == NULL || is_user_vaddr(arg_addr) == false)
+        exit(-1);
+      if (!pt_find(arg_addr))
+      {
+        if (!expand_stack(arg_addr, esp))
+          exit(-1);
+      }
+    }
+    f->eax = isdir(*(int *)((uint8_t *)esp + 4 * 1));
+    break;
+
+  case SYS_INUMBER:
+    for (int i = 1; i <= 1; i++)
+    {
+      uint8_t *arg_addr = ((uint8_t *)esp + 4 * i);
+      if (arg_addr == NULL || is_user_vaddr(arg_addr) == false)
+        exit(-1);
+      if (!pt_find(arg_addr))
+      {
+        if (!expand_stack(arg_addr, esp))
+          exit(-1);
+      }
+    }
+    f->eax = inumber(*(int *)((uint8_t *)esp + 4 * 1));
+    break;
+
+  case SYS_LOCKSTAT:
+    for (int i = 1; i <= 2; i++)
+    {
+      uint8_t *arg_addr = ((uint8_t *)esp + 4 * i);
+      if (arg_addr == NULL || is_user_vaddr(arg_addr) == false)
+        exit(-1);
+      if (!pt_find(arg_addr))
+      {
+        if (!expand_stack(arg_addr, esp))
+          exit(-1);
+      }
+    }
+    f->eax = lockstat(*(unsigned *)((uint8_t *)esp + 4 * 1),
+                      *(struct lockstat **)((uint8_t *)esp + 4 * 2));
+    break;
+
+  case SYS_FUTEX_WAIT:
+    for (int i = 1; i <= 3; i++)
+    {
+      uint8_t *arg_addr = ((uint8_t *)esp + 4 * i);
+      if (arg_addr == NULL || is_user_vaddr(arg_addr) == false)
+        exit(-1);
+      if (!pt_find(arg_addr))
+      {
+        if (!expand_stack(arg_addr, esp))
+          exit(-1);
+      }
+    }
+    f->eax = futex_wait(*(int **)((uint8_t *)esp + 4 * 1),
+                        *(int *)((uint8_t *)esp + 4 * 2),
+                        *(int *)((uint8_t *)esp + 4 * 3));
+    break;
+
+  case SYS_FUTEX_WAKE:
+    for (int i = 1; i <= 2; i++)
+    {
+      uint8_t *arg_addr = ((uint8_t *)esp + 4 * i);
+      if (arg_addr == NULL || is_user_vaddr(arg_addr) == false)
+        exit(-1);
+      if (!pt_find(arg_addr))
+      {
+        if (!expand_stack(arg_addr, esp))
+          exit(-1);
+      }
+    }
+    f->eax = futex_wake(*(int **)((uint8_t *)esp + 4 * 1),
+                        *(int *)((uint8_t *)esp + 4 * 2));
+    break;
+
+  case SYS_GETRUSAGE:
+    for (int i = 1; i <= 2; i++)
+    {
+      uint8_t *arg_addr = ((uint8_t *)esp + 4 * i);
+      if (arg_addr == NULL || is_user_vaddr(arg_addr) == false)
+        exit(-1);
+      if (!pt_find(arg_addr))
+      {
+        if (!expand_stack(arg_addr, esp))
+          exit(-1);
+      }
+    }
+    f->eax = getrusage(*(int *)((uint8_t *)esp + 4 * 1),
+                       *(struct rusage **)((uint8_t *)esp + 4 * 2));
+    break;
+
+  case SYS_SCHED_SETQUOTA:
+    for (int i = 1; i <= 1; i++)
+    {
+      uint8_t *arg_addr = ((uint8_t *)esp + 4 * i);
+      if (arg_addr == NULL || is_user_vaddr(arg_addr) == false)
+        exit(-1);
+      if (!pt_find(arg_addr))
+      {
+        if (!expand_stack(arg_addr, esp))
+          exit(-1);
+      }
+    }
+    f->eax = thread_set_quota(*(int *)((uint8_t *)esp + 4 * 1));
+    break;
+
   default:
     break;
   }
@@ -289,6 +453,11 @@ void exit(int status)
   printf("%s: exit(%d)\n", thread_name(), status);
   thread_current()->exit_status = status;
 
+  if (lock_held_by_current_thread(&file_lock))
+    lock_release(&file_lock);
+  if (thread_current()->locked_inode != NULL)
+    unlock_inode();
+
   for (i = 0; i < 128; i++)
   {
     if (*(f_list + i))
@@ -380,17 +549,13 @@ int filesize(int fd)
   if (fd < 3 || fd >= 128)
     exit(-1);
 
-  lock_acquire(&file_lock);
-
   struct file *f = thread_current()->fd[fd];
   if (!f)
-  {
-    lock_release(&file_lock);
     exit(-1);
-  }
-  int size = file_length(f);
 
-  lock_release(&file_lock);
+  inode_lock_read(file_get_inode(f));
+  int size = file_length(f);
+  inode_unlock_read(file_get_inode(f));
 
   return size;
 }
@@ -400,8 +565,6 @@ int read(int fd, void *buffer, unsigned size)
   if (!buffer || !is_user_vaddr(buffer))
     exit(-1);
 
-  lock_acquire(&file_lock);
-
   struct file *f = (fd >= 3 && fd < 128) ? thread_current()->fd[fd] : NULL;
   off_t bytes = 0;
 
@@ -419,14 +582,16 @@ int read(int fd, void *buffer, unsigned size)
     buf_ptr[bytes] = '\0';
   }
   else if (!f)
-  {
-    lock_release(&file_lock);
     exit(-1);
-  }
+  else if (inode_is_dir(file_get_inode(f)))
+    bytes = -1;
   else
+  {
+    lock_inode(f, false);
     bytes = file_read(f, buffer, size);
+    unlock_inode();
+  }
 
-  lock_release(&file_lock);
   return bytes;
 }
 
@@ -435,8 +600,6 @@ int write(int fd, const void *buffer, unsigned size)
   if (!buffer || !is_user_vaddr(buffer))
     exit(-1);
 
-  lock_acquire(&file_lock);
-
   off_t bytes = 0;
   struct file *f = (fd > 1 && fd < 128) ? thread_current()->fd[fd] : NULL;
 
@@ -446,39 +609,68 @@ int write(int fd, const void *buffer, unsigned size)
     bytes = size;
   }
   else if (!f)
-  {
-    lock_release(&file_lock);
     exit(-1);
-  }
+  else if (inode_is_dir(file_get_inode(f)))
+    bytes = -1;
   else
   {
+    lock_inode(f, true);
     if (f->deny_write)
       file_deny_write(f);
 
     bytes = file_write(f, buffer, size);
+    unlock_inode();
   }
 
-  lock_release(&file_lock);
   return bytes;
 }
 
+/* Locks the inode of F for reading or, if WRITE is true, for
+   writing, and remembers it in the current thread.  Copying to
+   or from a bad user buffer faults and exits the process with
+   the lock still held, so exit() releases it from there. */
+static void lock_inode(struct file *f, bool write)
+{
+  struct thread *cur = thread_current();
+  struct inode *inode = file_get_inode(f);
+
+  ASSERT(cur->locked_inode == NULL);
+
+  if (write)
+    inode_lock_write(inode);
+  else
+    inode_lock_read(inode);
+  cur->locked_inode = inode;
+  cur->locked_inode_write = write;
+}
+
+/* Releases the inode locked by lock_inode(). */
+static void unlock_inode(void)
+{
+  struct thread *cur = thread_current();
+  struct inode *inode = cur->locked_inode;
+
+  ASSERT(inode != NULL);
+
+  cur->locked_inode = NULL;
+  if (cur->locked_inode_write)
+    inode_unlock_write(inode);
+  else
+    inode_unlock_read(inode);
+}
+
+/* The file position belongs to the descriptor, not the inode,
+   so seek() and tell() need no lock. */
 void seek(int fd, unsigned position)
 {
   if (fd < 3 || fd >= 128)
     exit(-1);
 
-  lock_acquire(&file_lock);
-
   struct file *f = thread_current()->fd[fd];
   if (!f)
-  {
-    lock_release(&file_lock);
     exit(-1);
-  }
 
   file_seek(f, position);
-
-  lock_release(&file_lock);
   return;
 }
 
@@ -487,20 +679,11 @@ unsigned int tell(int fd)
   if (fd < 3 || fd >= 128)
     exit(-1);
 
-  lock_acquire(&file_lock);
-
   struct file *f = thread_current()->fd[fd];
   if (!f)
-  {
-    lock_release(&file_lock);
     exit(-1);
-  }
-
-  unsigned pos = file_tell(f);
 
-  lock_release(&file_lock);
-
-  return pos;
+  return file_tell(f);
 }
 
 void close(int fd)
@@ -513,7 +696,9 @@ void close(int fd)
 
   thread_current()->fd[fd] = NULL;
 
+  lock_acquire(&file_lock);
   file_close(tmp);
+  lock_release(&file_lock);
   return;
 }
 
@@ -540,3 +725,123 @@ void munmap(unsigned int mapid)
   mm_free(mapid);
   return;
 }
+
+bool chdir(const char *dir)
+{
+  if (dir == NULL || is_user_vaddr(dir) == false)
+    exit(-1);
+
+  lock_acquire(&file_lock);
+  bool res = filesys_chdir(dir);
+  lock_release(&file_lock);
+
+  return res;
+}
+
+bool mkdir(const char *dir)
+{
+  if (dir == NULL || is_user_vaddr(dir) == false)
+    exit(-1);
+
+  lock_acquire(&file_lock);
+  bool res = filesys_mkdir(dir);
+  lock_release(&file_lock);
+
+  return res;
+}
+
+/* Reads the next entry of the directory open as FD into NAME.
+   The name is copied out only after file_lock is released,
+   since touching NAME may fault. */
+bool readdir(int fd, char *name)
+{
+  if (!name || !is_user_vaddr(name) || !is_user_vaddr(name + NAME_MAX))
+    exit(-1);
+  if (fd < 3 || fd >= 128)
+    exit(-1);
+
+  struct file *f = thread_current()->fd[fd];
+  if (!f)
+    exit(-1);
+  if (!inode_is_dir(file_get_inode(f)))
+    return false;
+
+  char buf[NAME_MAX + 1];
+  lock_acquire(&file_lock);
+  off_t pos = file_tell(f);
+  bool res = dir_readdir_at(file_get_inode(f), &pos, buf);
+  file_seek(f, pos);
+  lock_release(&file_lock);
+
+  if (res)
+    strlcpy(name, buf, NAME_MAX + 1);
+  return res;
+}
+
+bool isdir(int fd)
+{
+  if (fd < 3 || fd >= 128)
+    exit(-1);
+
+  struct file *f = thread_current()->fd[fd];
+  if (!f)
+    exit(-1);
+
+  return inode_is_dir(file_get_inode(f));
+}
+
+int inumber(int fd)
+{
+  if (fd < 3 || fd >= 128)
+    exit(-1);
+
+  struct file *f = thread_current()->fd[fd];
+  if (!f)
+    exit(-1);
+
+  return inode_get_inumber(file_get_inode(f));
+}
+
+/* Copies the contention statistics of the IDX'th profiled kernel
+   lock into *BUF.  Returns false once IDX runs past the last
+   lock, and always when the kernel is built without
+   LOCK_PROFILE. */
+bool lockstat(unsigned idx UNUSED, struct lockstat *buf)
+{
+  if (!buf || !is_user_vaddr(buf) || !is_user_vaddr(buf + 1))
+    exit(-1);
+
+#ifdef LOCK_PROFILE
+  struct lockstat stats;
+  if (!lock_get_stats(idx, &stats))
+    return false;
+  memcpy(buf, &stats, sizeof stats);
+  return true;
+#else
+  return false;
+#endif
+}
+
+/* Copies the resource usage of the running process into *USAGE
+   if WHO is RUSAGE_SELF, or the summed usage of all of its
+   children that it has waited for, and their children in turn,
+   if WHO is RUSAGE_CHILDREN.  Returns 0 if successful, -1 if WHO
+   is invalid. */
+int getrusage(int who, struct rusage *usage)
+{
+  if (!usage || !is_user_vaddr(usage) || !is_user_vaddr(usage + 1))
+    exit(-1);
+
+  if (who != RUSAGE_SELF && who != RUSAGE_CHILDREN)
+    return -1;
+
+  /* Take a snapshot, since the timer interrupt updates the
+     running thread's tick counts. */
+  struct thread *cur = thread_current();
+  enum intr_level old_level = intr_disable();
+  struct rusage ru = who == RUSAGE_SELF ? cur->rusage : cur->child_rusage;
+  intr_set_level(old_level);
+
+  memcpy(usage, &ru, sizeof ru);
+  return 0;
+}
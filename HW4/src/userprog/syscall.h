@@ -25,5 +25,14 @@ int max_of_four_int(int a, int b, int c, int d);
 /*****/
 unsigned int mmap(int fd, void *addr);
 void munmap(unsigned int mapid);
+bool chdir(const char *dir);
+bool mkdir(const char *dir);
+bool readdir(int fd, char *name);
+bool isdir(int fd);
+int inumber(int fd);
+struct lockstat;
+bool lockstat(unsigned idx, struct lockstat *buf);
+struct rusage;
+int getrusage(int who, struct rusage *usage);
 
 #endif /* userprog/syscall.h */
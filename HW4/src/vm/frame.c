@@ -15,6 +15,8 @@ struct lock frame_lock;
 void frame_init(void)
 {
   lock_init(&frame_lock);
+  lock_set_handoff(&frame_lock, true);
+  lock_register(&frame_lock, "frame_lock");
   list_init(&frame_list);
   victim = NULL;
   return;
@@ -144,6 +146,9 @@ static void ft_evict(void)
   bool is_dirty = pagedir_is_dirty(frame->thread->pagedir, frame->pte->vaddr);
   pt_type type = frame->pte->type;
 
+  /* mm_map() reserved every sector of the file, so this write only
+     fills cache slots.  Taking the inode lock here could deadlock
+     with a read() or write() that faults while holding it. */
   if (is_dirty && type == MAPPED)
     file_write_at(frame->pte->file, frame->kaddr, frame->pte->read_bytes, frame->pte->offset);
 
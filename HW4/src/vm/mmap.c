@@ -6,7 +6,9 @@
 #include "threads/malloc.h"
 #include "userprog/pagedir.h"
 #include "userprog/syscall.h"
+#include "filesys/inode.h"
 #include "filesys/off_t.h"
+#include <timepage.h>
 
 extern struct lock file_lock;
 static struct file *mm_get_file(int fd);
@@ -15,7 +17,15 @@ static struct mm_entry *mm_get_entry(unsigned int mapid);
 
 unsigned int mm_map(int fd, void *addr)
 {
-  if (pg_ofs(addr) || !addr || !is_user_vaddr(addr) || pt_find(addr))
+  struct file *file = mm_get_file(fd);
+
+  if (pg_ofs(addr) || !addr || !is_user_vaddr(addr) || pt_find(addr) || !file)
+    return (unsigned int)-1;
+
+  /* The time page is mapped straight into the page directory,
+     without a page table entry for pt_find() to see. */
+  if ((uint8_t *)addr <= (uint8_t *)TIMEPAGE &&
+      (uint8_t *)TIMEPAGE < (uint8_t *)addr + file_length(file))
     return (unsigned int)-1;
 
   struct mm_entry *mme = (struct mm_entry *)malloc(sizeof(struct mm_entry));
@@ -23,9 +33,25 @@ unsigned int mm_map(int fd, void *addr)
     return (unsigned int)-1;
 
   lock_acquire(&file_lock);
-  mme->file = file_reopen(mm_get_file(fd));
+  mme->file = file_reopen(file);
   lock_release(&file_lock);
 
+  /* Fill in the file's holes now, while it is safe to take its
+     lock, so that ft_evict() can write pages back without
+     allocating and so without the inode lock. */
+  struct inode *inode = file_get_inode(mme->file);
+  inode_lock_write(inode);
+  bool reserved = inode_reserve(inode, file_length(mme->file));
+  inode_unlock_write(inode);
+  if (!reserved)
+  {
+    lock_acquire(&file_lock);
+    file_close(mme->file);
+    lock_release(&file_lock);
+    free(mme);
+    return (unsigned int)-1;
+  }
+
   mme->mapid = (thread_current()->map_list_size)++;
   list_init(&mme->pte_list);
   list_push_back(&(thread_current()->map_list), &(mme->elem));
@@ -63,7 +89,7 @@ void mm_free(unsigned int mapid)
 
     if (pte->is_loaded && pagedir_is_dirty(thread_current()->pagedir, pte->vaddr))
     {
-      lock_acquire(&file_lock);
+      inode_lock_write(file_get_inode(pte->file));
 
       size_t read_byte = pte->read_bytes;
       size_t temp = (size_t)file_write_at(pte->file, pte->vaddr, pte->read_bytes, pte->offset);
@@ -71,7 +97,7 @@ void mm_free(unsigned int mapid)
       if (read_byte != temp)
         NOT_REACHED();
 
-      lock_release(&file_lock);
+      inode_unlock_write(file_get_inode(pte->file));
 
       free_page(pagedir_get_page(thread_current()->pagedir, pte->vaddr));
     }
@@ -1,6 +1,7 @@
 #include "vm/swap.h"
 #include "devices/block.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 struct block *swap_block;
@@ -9,6 +10,7 @@ struct lock swap_lock;
 void swap_init(void)
 {
   lock_init(&swap_lock);
+  lock_register(&swap_lock, "swap_lock");
   swap_bitmap = bitmap_create(PGSIZE);
   return;
 }
@@ -24,12 +26,8 @@ void swap_in(size_t index, void *kaddr)
   index--;
   struct block *swap_block = block_get_role(BLOCK_SWAP);
   lock_acquire(&swap_lock);
-  for (size_t block_offset = 0; block_offset < 8; block_offset++)
-  {
-    size_t sector = (index << 3) + block_offset;
-    void *buffer = kaddr + (BLOCK_SECTOR_SIZE * block_offset);
-    block_read(swap_block, sector, buffer);
-  }
+  block_read_multi(swap_block, index << 3, PGSIZE / BLOCK_SECTOR_SIZE, kaddr);
+  thread_current()->rusage.block_reads += PGSIZE / BLOCK_SECTOR_SIZE;
   bitmap_set_multiple(swap_bitmap, index, 1, false);
   lock_release(&swap_lock);
   return;
@@ -40,12 +38,9 @@ size_t swap_out(void *kaddr)
   swap_block = block_get_role(BLOCK_SWAP);
   lock_acquire(&swap_lock);
   size_t swap_index = bitmap_scan_and_flip(swap_bitmap, 0, 1, false);
-  for (size_t block_offset = 0; block_offset < 8; block_offset++)
-  {
-    size_t sector = (swap_index << 3) + block_offset;
-    void *buffer = kaddr + (BLOCK_SECTOR_SIZE * block_offset);
-    block_write(swap_block, sector, buffer);
-  }
+  block_write_multi(swap_block, swap_index << 3, PGSIZE / BLOCK_SECTOR_SIZE,
+                    kaddr);
+  thread_current()->rusage.block_writes += PGSIZE / BLOCK_SECTOR_SIZE;
   lock_release(&swap_lock);
   return swap_index + 1;
 }